@@ -0,0 +1,239 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <cxxopts.hpp>
+#include "common.h"
+#include "bin.h"
+#include "car.h"
+#include "dff.h"
+#include "engine.h"
+#include "json.h"
+#include "synthetic.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkResult
+{
+    int64_t iterations{ 0 };
+    double seconds{ 0. };
+};
+
+// repeats the body until min_time is spent, setup runs before every iteration and isn't timed
+BenchmarkResult run_benchmark(double min_time, const std::function<void()>& setup, const std::function<void()>& body)
+{
+    BenchmarkResult result;
+    do {
+        if (setup) {
+            setup();
+        }
+        const Clock::time_point begin = Clock::now();
+        body();
+        result.seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+        result.iterations++;
+    } while (result.seconds < min_time);
+
+    return result;
+}
+
+void print_header()
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-32s %10s %12s %12s %12s\n", "benchmark", "iterations", "ms/iter", "Mverts/s", "MB/s");
+    std::cout << line << std::flush;
+}
+
+void print_result(const std::string& name, const BenchmarkResult& result, int64_t num_vertices, uint64_t num_bytes)
+{
+    const double seconds_per_iteration = result.seconds / result.iterations;
+    const double mverts = num_vertices / seconds_per_iteration / 1e6;
+    const double mbytes = num_bytes / seconds_per_iteration / (1024. * 1024.);
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-32s %10lld %12.3f %12.2f %12.2f\n", name.c_str(), static_cast<long long>(result.iterations), seconds_per_iteration * 1e3, mverts, mbytes);
+    std::cout << line << std::flush;
+}
+
+uint64_t get_file_size(const std::string& file_name)
+{
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(file_name, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+class Benchmarks
+{
+public:
+    Benchmarks(double in_min_time, std::string in_filter) : min_time(in_min_time), filter(std::move(in_filter))
+    {}
+
+    void run(const std::string& name, int64_t num_vertices, uint64_t num_bytes, const std::function<void()>& setup, const std::function<void()>& body)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+        print_result(name, run_benchmark(min_time, setup, body), num_vertices, num_bytes);
+    }
+
+private:
+    double min_time;
+    std::string filter;
+};
+
+void run_scenario(Benchmarks& benchmarks, const gta_to_ue::bench::SyntheticModel& model, const std::string& dir)
+{
+    const std::string dff_file = (std::filesystem::path(dir) / (model.name + ".dff")).string();
+    rw::Clump* clump = gta_to_ue::bench::create_clump(model);
+    const int64_t num_vertices = gta_to_ue::bench::get_num_vertices(clump);
+    const bool written = gta_to_ue::bench::write_dff(clump, dff_file);
+    clump->destroy();
+    if (!written) {
+        return;
+    }
+    const uint64_t dff_size = get_file_size(dff_file);
+
+    ConvertingOptions converting_options;
+    converting_options.is_car = model.car;
+
+    // whole parse, file read included
+    benchmarks.run(model.name + "/dff::parse", num_vertices, dff_size, nullptr, [&] {
+        gta_to_ue::Mesh mesh;
+        gta_to_ue::dff::destroy(gta_to_ue::dff::parse(dff_file, converting_options, mesh));
+    });
+
+    gta_to_ue::Mesh mesh_data;
+    clump = gta_to_ue::dff::parse(dff_file, converting_options, mesh_data);
+    if (!clump) {
+        return;
+    }
+
+    // the parse stages run on the clump read once, the triangles are already generated by dff::parse
+    const rw::FrameList_ frame_list{
+        .numFrames = clump->getFrame()->count(),
+        .frames = static_cast<rw::Frame**>(rwMalloc(clump->getFrame()->count() * sizeof(rw::Frame*), rw::MEMDUR_FUNCTION | rw::ID_CLUMP))
+    };
+    rw::makeFrameList(clump->getFrame(), frame_list.frames);
+
+    benchmarks.run(model.name + "/parse_rw_frames", num_vertices, 0, nullptr, [&] {
+        gta_to_ue::Mesh mesh;
+        parse_rw_frames(frame_list, converting_options, mesh);
+    });
+
+    benchmarks.run(model.name + "/parse_rw_materials", num_vertices, 0, nullptr, [&] {
+        gta_to_ue::Mesh mesh;
+        FORLIST(lnk, clump->atomics)
+        {
+            parse_rw_materials(rw::Atomic::fromClump(lnk)->geometry, mesh, model.name);
+        }
+    });
+
+    benchmarks.run(model.name + "/parse_rw_geometry", num_vertices, 0, nullptr, [&] {
+        gta_to_ue::Mesh mesh;
+        FORLIST(lnk, clump->atomics)
+        {
+            const rw::Atomic* atomic = rw::Atomic::fromClump(lnk);
+            parse_rw_geometry(atomic->geometry, rw::findPointer(atomic->getFrame(), reinterpret_cast<void**>(frame_list.frames), frame_list.numFrames), mesh, converting_options, model.name);
+        }
+    });
+
+    if (mesh_data.has_skeleton) {
+        // parse_rw_skin_data refills the geometries parsed by dff::parse
+        gta_to_ue::Mesh skinned_mesh = mesh_data;
+        benchmarks.run(model.name + "/parse_rw_skin_data", num_vertices, 0, nullptr, [&] {
+            int32_t geometry_id = 0;
+            FORLIST(lnk, clump->atomics)
+            {
+                parse_rw_skin_data(rw::Atomic::fromClump(lnk)->geometry, geometry_id++, skinned_mesh);
+            }
+        });
+    }
+    rwFree(frame_list.frames);
+    gta_to_ue::dff::destroy(clump);
+
+    if (model.car) {
+        gta_to_ue::Mesh car_mesh;
+        benchmarks.run(model.name + "/build_car", num_vertices, 0, [&] { car_mesh = mesh_data; }, [&] {
+            gta_to_ue::build_car(car_mesh);
+        });
+    }
+
+    const std::string base_name = (std::filesystem::path(dir) / model.name).string();
+    const std::pair<const char*, JsonLayout> json_layouts[] = {
+        { "objects", JsonLayout::objects },
+        { "compact", JsonLayout::compact }
+    };
+    for (const auto& [layout_name, json_layout] : json_layouts) {
+        const std::string json_file = base_name + "_" + layout_name + ".dffjson";
+        ExportOptions export_options;
+        export_options.json_layout = json_layout;
+        gta_to_ue::json::export_to_file(json_file, mesh_data, export_options);
+        benchmarks.run(model.name + "/json " + layout_name, num_vertices, get_file_size(json_file), nullptr, [&] {
+            gta_to_ue::json::export_to_file(json_file, mesh_data, export_options);
+        });
+    }
+
+    const std::string bin_file = base_name + ".dffbin";
+    gta_to_ue::bin::export_to_file(bin_file, mesh_data, ExportOptions());
+    benchmarks.run(model.name + "/bin", num_vertices, get_file_size(bin_file), nullptr, [&] {
+        gta_to_ue::bin::export_to_file(bin_file, mesh_data, ExportOptions());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("gta2ue_bench", "GTA 3 & GTA VC DFF converter benchmarks on synthetic models");
+
+    std::string dir = (std::filesystem::temp_directory_path() / "gta2ue_bench").string();
+    int32_t num_vertices = 16384;
+    int32_t num_materials = 8;
+    int32_t num_bones = 32;
+    double min_time = 1.;
+    int32_t num_workers = 1;
+    std::string filter;
+
+    options.add_options()
+        ("h,help", "print usage")
+        ("dir", "directory for the generated dff files and the exported outputs", cxxopts::value(dir))
+        ("vertices", "vertices per geometry, at most 65536", cxxopts::value(num_vertices))
+        ("materials", "materials per geometry", cxxopts::value(num_materials))
+        ("bones", "bones of the skinned model, at most 64", cxxopts::value(num_bones))
+        ("min-time", "minimum seconds spent in every benchmark", cxxopts::value(min_time))
+        ("workers", "threads parsing the atomics of a clump and serializing the sections of a json file, 1 by default", cxxopts::value(num_workers))
+        ("filter", "only run the benchmarks with this substring in their name, e.g. tristrip/ or /json", cxxopts::value(filter));
+
+    const auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error) {
+        std::cout << "directory: " << dir << " can't be created" << std::endl;
+        return 1;
+    }
+
+    if (!gta_to_ue::init_rw()) {
+        std::cout << "rw engine initialization error" << std::endl;
+        return 1;
+    }
+
+    const gta_to_ue::bench::SyntheticModel models[] = {
+        { .name = "trilist", .num_atomics = 4, .num_vertices = num_vertices, .num_materials = num_materials },
+        { .name = "tristrip", .num_atomics = 4, .num_vertices = num_vertices, .num_materials = num_materials, .tristrip = true },
+        { .name = "skinned", .num_atomics = 1, .num_vertices = num_vertices, .num_materials = num_materials, .skinned = true, .num_bones = num_bones },
+        { .name = "car", .num_atomics = 11, .num_vertices = num_vertices, .num_materials = num_materials, .car = true }
+    };
+
+    gta_to_ue::dff::set_num_atomic_workers(num_workers);
+    gta_to_ue::json::set_num_workers(num_workers);
+
+    Benchmarks benchmarks(min_time, filter);
+    print_header();
+    for (const auto& model : models) {
+        run_scenario(benchmarks, model, dir);
+    }
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const char* car_part_frames[] = {
+    "bonnet_dummy",
+    "boot_dummy",
+    "door_rf_dummy",
+    "door_lf_dummy",
+    "door_rr_dummy",
+    "door_lr_dummy",
+    "bump_front_dummy",
+    "bump_rear_dummy",
+    "wing_rf_dummy",
+    "wing_lf_dummy",
+    "windscreen_dummy"
+};
+
+const char* car_wheel_frames[] = {
+    "wheel_rf_dummy",
+    "wheel_rb_dummy",
+    "wheel_lf_dummy",
+    "wheel_lb_dummy"
+};
+
+rw::Frame* create_frame(rw::Frame* parent, const std::string& name, float x, float y, float z)
+{
+    rw::Frame* frame = rw::Frame::create();
+    const rw::V3d pos{ x, y, z };
+    frame->translate(&pos, rw::COMBINEREPLACE);
+
+    // the node name plugin keeps the name in a fixed-size buffer of the frame
+    std::strncpy(gta::getNodeName(frame), name.c_str(), 23);
+    if (parent) {
+        parent->addChild(frame);
+    }
+    return frame;
+}
+
+rw::Material* create_material(int32_t index)
+{
+    rw::Material* material = rw::Material::create();
+    material->color = rw::RGBA{ static_cast<rw::uint8>(40 * index), static_cast<rw::uint8>(255 - 20 * index), 128, 255 };
+
+    rw::Texture* texture = rw::Texture::create(nil);
+    std::snprintf(texture->name, sizeof(texture->name), "synthetic_%d", index);
+    std::snprintf(texture->mask, sizeof(texture->mask), "synthetic_%da", index);
+    material->setTexture(texture);
+    texture->destroy();
+
+    return material;
+}
+
+// wavy grid, materials are horizontal bands so strips stay long
+rw::Geometry* create_geometry(const gta_to_ue::bench::SyntheticModel& model, int32_t num_vertices)
+{
+    const int32_t side = std::clamp(static_cast<int32_t>(std::sqrt(static_cast<float>(num_vertices))), 2, 256);
+    const int32_t num_quads = (side - 1) * (side - 1);
+    const int32_t num_materials = std::max(model.num_materials, 1);
+
+    rw::uint32 flags = rw::Geometry::POSITIONS | rw::Geometry::NORMALS | rw::Geometry::TEXTURED | rw::Geometry::LIGHT | rw::Geometry::MODULATE;
+    if (model.tristrip) {
+        flags |= rw::Geometry::TRISTRIP;
+    }
+    rw::Geometry* geometry = rw::Geometry::create(side * side, num_quads * 2, flags);
+
+    for (int32_t i = 0; i < num_materials; i++) {
+        rw::Material* material = create_material(i);
+        geometry->matList.appendMaterial(material);
+        material->destroy();
+    }
+
+    rw::MorphTarget& morph_target = geometry->morphTargets[0];
+    for (int32_t y = 0; y < side; y++) {
+        for (int32_t x = 0; x < side; x++) {
+            const int32_t i = y * side + x;
+            const float height = 0.1f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+            morph_target.vertices[i] = rw::V3d{ x * 0.05f, y * 0.05f, height };
+            morph_target.normals[i] = rw::V3d{ 0.f, 0.f, 1.f };
+            geometry->texCoords[0][i] = rw::TexCoords{ static_cast<float>(x) / (side - 1), static_cast<float>(y) / (side - 1) };
+        }
+    }
+
+    int32_t t = 0;
+    for (int32_t y = 0; y < side - 1; y++) {
+        const rw::uint16 material_id = static_cast<rw::uint16>(y * num_materials / (side - 1));
+        for (int32_t x = 0; x < side - 1; x++) {
+            const rw::uint16 a = static_cast<rw::uint16>(y * side + x);
+            const rw::uint16 b = static_cast<rw::uint16>(a + 1);
+            const rw::uint16 c = static_cast<rw::uint16>(a + side);
+            const rw::uint16 d = static_cast<rw::uint16>(c + 1);
+            geometry->triangles[t++] = rw::Triangle{ { a, b, d }, material_id };
+            geometry->triangles[t++] = rw::Triangle{ { a, d, c }, material_id };
+        }
+    }
+
+    geometry->calculateBoundingSphere();
+    if (model.tristrip) {
+        geometry->buildTristrips();
+    } else {
+        geometry->buildMeshes();
+    }
+
+    return geometry;
+}
+
+void add_skin(rw::Geometry* geometry, int32_t num_bones)
+{
+    rw::Skin* skin = rwNewT(rw::Skin, 1, rw::MEMDUR_EVENT | rw::ID_SKIN);
+    skin->init(num_bones, num_bones, geometry->numVertices);
+    for (int32_t i = 0; i < num_bones; i++) {
+        skin->usedBones[i] = static_cast<rw::uint8>(i);
+        float* matrix = &skin->inverseMatrices[i * 16];
+        std::fill(matrix, matrix + 16, 0.f);
+        matrix[0] = matrix[5] = matrix[10] = matrix[15] = 1.f;
+    }
+    for (int32_t i = 0; i < geometry->numVertices; i++) {
+        const rw::uint8 bone = static_cast<rw::uint8>(i % num_bones);
+        skin->indices[i * 4 + 0] = bone;
+        skin->indices[i * 4 + 1] = static_cast<rw::uint8>((bone + 1) % num_bones);
+        skin->indices[i * 4 + 2] = 0;
+        skin->indices[i * 4 + 3] = 0;
+        skin->weights[i * 4 + 0] = 0.75f;
+        skin->weights[i * 4 + 1] = 0.25f;
+        skin->weights[i * 4 + 2] = 0.f;
+        skin->weights[i * 4 + 3] = 0.f;
+    }
+    skin->numWeights = 2;
+    rw::Skin::set(geometry, skin);
+}
+
+// bone chain below the root, the hierarchy lives on the first bone like in the game peds
+void add_bones(rw::Frame* root, int32_t num_bones)
+{
+    std::vector<rw::int32> node_ids(num_bones);
+    std::vector<rw::int32> node_flags(num_bones, 0);
+    node_flags.back() = rw::HAnimHierarchy::POP;
+
+    rw::Frame* parent = root;
+    rw::Frame* first_bone = nullptr;
+    for (int32_t i = 0; i < num_bones; i++) {
+        rw::Frame* bone = create_frame(parent, "bone" + std::to_string(i), 0.f, 0.f, 0.1f);
+        node_ids[i] = i;
+        rw::HAnimData::get(bone)->id = i;
+        if (!first_bone) {
+            first_bone = bone;
+        }
+        parent = bone;
+    }
+
+    rw::HAnimData::get(first_bone)->hierarchy = rw::HAnimHierarchy::create(num_bones, node_flags.data(), node_ids.data(), 0, 36);
+}
+
+void add_atomic(rw::Clump* clump, rw::Frame* frame, rw::Geometry* geometry)
+{
+    rw::Atomic* atomic = rw::Atomic::create();
+    atomic->setFrame(frame);
+    atomic->setGeometry(geometry, 0);
+    geometry->destroy();
+    clump->addAtomic(atomic);
+}
+
+rw::Clump* gta_to_ue::bench::create_clump(const SyntheticModel& model)
+{
+    rw::Clump* clump = rw::Clump::create();
+    rw::Frame* root = create_frame(nullptr, model.name, 0.f, 0.f, 0.f);
+    clump->setFrame(root);
+
+    const int32_t num_vertices = std::min(model.num_vertices, 65536);
+
+    if (model.car) {
+        rw::Frame* chassis_dummy = create_frame(root, "chassis_dummy", 0.f, 0.f, 0.f);
+        add_atomic(clump, create_frame(chassis_dummy, "chassis_hi", 0.f, 0.f, 0.f), create_geometry(model, num_vertices));
+        add_atomic(clump, create_frame(root, "chassis_vlo", 0.f, 0.f, 0.f), create_geometry(model, num_vertices / 16));
+
+        for (int32_t i = 0; i < model.num_atomics && i < static_cast<int32_t>(std::size(car_part_frames)); i++) {
+            const std::string dummy_name = car_part_frames[i];
+            rw::Frame* dummy = create_frame(root, dummy_name, 0.5f * i, 1.f, 0.2f);
+            const std::string part_name = dummy_name.substr(0, dummy_name.size() - std::strlen("_dummy")) + "_hi_ok";
+            add_atomic(clump, create_frame(dummy, part_name, 0.f, 0.f, 0.f), create_geometry(model, num_vertices / 4));
+        }
+        for (const char* wheel_frame : car_wheel_frames) {
+            create_frame(root, wheel_frame, 1.f, 1.f, 0.f);
+        }
+        return clump;
+    }
+
+    if (model.skinned) {
+        add_bones(root, std::clamp(model.num_bones, 1, 64));
+    }
+
+    for (int32_t i = 0; i < model.num_atomics; i++) {
+        rw::Geometry* geometry = create_geometry(model, num_vertices);
+        if (model.skinned) {
+            add_skin(geometry, std::clamp(model.num_bones, 1, 64));
+        }
+        // skinned atomics sit on the root like the game peds, static ones on their own frames
+        rw::Frame* frame = model.skinned ? root : create_frame(root, "part" + std::to_string(i), 0.f, 0.f, 0.f);
+        add_atomic(clump, frame, geometry);
+    }
+
+    return clump;
+}
+
+int32_t gta_to_ue::bench::get_num_vertices(const rw::Clump* clump)
+{
+    int32_t num_vertices = 0;
+    FORLIST(lnk, const_cast<rw::Clump*>(clump)->atomics)
+    {
+        num_vertices += rw::Atomic::fromClump(lnk)->geometry->numVertices;
+    }
+    return num_vertices;
+}
+
+bool gta_to_ue::bench::write_dff(rw::Clump* clump, const std::string& file_name)
+{
+    rw::StreamFile stream;
+    if (!stream.open(file_name.c_str(), "wb")) {
+        std::cout << "file: " << file_name << " can't be written" << std::endl;
+        return false;
+    }
+
+    const bool written = clump->streamWrite(&stream);
+    stream.close();
+    return written;
+}
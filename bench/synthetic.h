@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace bench {
+        struct SyntheticModel
+        {
+            std::string name;
+            // every atomic gets a grid geometry of about num_vertices vertices, at most 65536
+            int32_t num_atomics{ 1 };
+            int32_t num_vertices{ 16384 };
+            int32_t num_materials{ 8 };
+            // tristrip or trilist mesh header
+            bool tristrip{ false };
+            // hanim hierarchy with a bone chain and a two bone skin on every vertex
+            bool skinned{ false };
+            int32_t num_bones{ 32 };
+            // car frame tree with the *_dummy frames, *_hi_ok parts and a chassis_vlo
+            bool car{ false };
+        };
+
+        // builds the clump through librw, the caller destroys it
+        rw::Clump* create_clump(const SyntheticModel& model);
+
+        int32_t get_num_vertices(const rw::Clump* clump);
+
+        bool write_dff(rw::Clump* clump, const std::string& file_name);
+    }
+}
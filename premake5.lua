@@ -3,6 +3,7 @@ librwgta = 'vendor/librwgta'
 rapidjson = 'vendor/rapidjson'
 cxxopts = 'vendor/cxxopts'
 glfwdir = 'vendor/glfw'
+zstd = 'vendor/zstd'
 
 local function addSrcFiles( prefix )
 	return prefix .. "/*cpp", prefix .. "/*.h", prefix .. "/*.c", prefix .. "/*.ico", prefix .. "/*.rc"
@@ -11,7 +12,7 @@ end
 workspace "gta2ue"
     language "C++"
     configurations {"Debug","Release"}
-    platforms {"Win64"}
+    platforms {"Win64", "Linux64"}
     startproject "gta2ue"
     location "build"
     symbols "Full"
@@ -20,13 +21,18 @@ workspace "gta2ue"
     libdirs { 
         "lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/librw",
         "lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/librwgta",
-        "lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/glfw"
+        "lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/glfw",
+        "lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/zstd"
     }
 
     filter { "platforms:win*" }
         system "Windows"
         architecture "amd64"
 
+    filter { "platforms:linux*" }
+        system "Linux"
+        architecture "x86_64"
+
 	filter "configurations:Debug"
 		defines { "DEBUG" }
 
@@ -41,6 +47,7 @@ workspace "gta2ue"
         targetname "glfw"
         language "C"
         targetdir("lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/glfw")
+        removeplatforms { "Linux64" }
 
         files { path.join(glfwdir, "src/context.c") }
         files { path.join(glfwdir, "src/init.c") } 
@@ -79,7 +86,6 @@ workspace "gta2ue"
         kind "StaticLib"
         targetname "rw"
         targetdir("lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/librw")
-        dependson "glfw"
         defines { "RW_NULL" }
 
         includedirs { path.join(glfwdir, "include") }
@@ -93,9 +99,35 @@ workspace "gta2ue"
             defines { "_CRT_SECURE_NO_WARNINGS", "_CRT_NONSTDC_NO_DEPRECATE" }
             staticruntime "off"
             buildoptions { "/Zc:sizedDealloc-" }
+            dependson "glfw"
+
+        filter { "platforms:linux*" }
+            buildoptions { "-fno-sized-deallocation" }
         
         filter {}
     
+    -- only the compressor is needed, the outputs are written and never read back
+    project "zstd"
+        kind "StaticLib"
+        targetname "zstd"
+        language "C"
+        targetdir("lib/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}/zstd")
+        defines { "ZSTD_DISABLE_ASM" }
+
+        includedirs { path.join(zstd, "lib") }
+
+        files { path.join(zstd, "lib/zstd.h") }
+        files { path.join(zstd, "lib/common/*.c") }
+        files { path.join(zstd, "lib/common/*.h") }
+        files { path.join(zstd, "lib/compress/*.c") }
+        files { path.join(zstd, "lib/compress/*.h") }
+
+        filter { "platforms:win*" }
+            architecture "amd64"
+            staticruntime "off"
+
+        filter {}
+
     project "librwgta"
         kind "StaticLib"
         targetname "rwgta"
@@ -116,19 +148,55 @@ workspace "gta2ue"
     project "gta2ue"
         kind "ConsoleApp"
         cppdialect "C++20"
-        targetextension ".exe"
         targetname "gta2ue"
         targetdir "bin/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}"
-        dependson "librwgta"
+        dependson { "librwgta", "zstd" }
         staticruntime "off"
         defines { "RWLIBS", "RW_NULL" }
-        links { "rw", "librwgta", "opengl32", "glfw" }
         includedirs { librw }
         includedirs { path.join(rapidjson, "include") }
         includedirs { path.join(librwgta, "src") }
         includedirs { path.join(cxxopts, "include") }
         includedirs { path.join(glfwdir, "include") }
+        includedirs { path.join(zstd, "lib") }
 
         files { addSrcFiles("src") }
+
+        filter { "platforms:win*" }
+            targetextension ".exe"
+            links { "rw", "librwgta", "zstd", "opengl32", "glfw" }
+
+        filter { "platforms:linux*" }
+            links { "librwgta", "rw", "zstd", "pthread" }
      
+        filter {}
+
+    -- parse and export benchmarks on generated dff files, links the converter sources without its main
+    project "gta2ue_bench"
+        kind "ConsoleApp"
+        cppdialect "C++20"
+        targetname "gta2ue_bench"
+        targetdir "bin/%{cfg.system}-%{cfg.architecture}-%{cfg.buildcfg}"
+        dependson { "librwgta", "zstd" }
+        staticruntime "off"
+        defines { "RWLIBS", "RW_NULL" }
+        includedirs { "src" }
+        includedirs { librw }
+        includedirs { path.join(rapidjson, "include") }
+        includedirs { path.join(librwgta, "src") }
+        includedirs { path.join(cxxopts, "include") }
+        includedirs { path.join(glfwdir, "include") }
+        includedirs { path.join(zstd, "lib") }
+
+        files { addSrcFiles("src") }
+        files { addSrcFiles("bench") }
+        removefiles { "src/main.cpp" }
+
+        filter { "platforms:win*" }
+            targetextension ".exe"
+            links { "rw", "librwgta", "zstd", "opengl32", "glfw" }
+
+        filter { "platforms:linux*" }
+            links { "librwgta", "rw", "zstd", "pthread" }
+
         filter {}
\ No newline at end of file
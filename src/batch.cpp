@@ -0,0 +1,223 @@
+#include "batch.h"
+#include "converter.h"
+#include "hash.h"
+#include "txd.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+bool is_dff_file(const std::filesystem::path& path)
+{
+    std::string ext = path.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".dff";
+}
+
+std::string make_output_file(const std::filesystem::path& input_file, const std::filesystem::path& relative_path, const std::string& output_dir, const ExportOptions& export_options)
+{
+    if (output_dir.empty()) {
+        return gta_to_ue::get_default_output_file(input_file.string(), export_options);
+    }
+
+    std::filesystem::path output_file = std::filesystem::path(output_dir) / relative_path;
+    output_file.replace_extension(gta_to_ue::get_output_extension(export_options));
+    return output_file.string();
+}
+
+bool collect_jobs_from_dir(const std::filesystem::path& dir, const std::string& output_dir, const ExportOptions& export_options, std::vector<gta_to_ue::batch::Job>& jobs)
+{
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir, error)) {
+        if (!entry.is_regular_file() || !is_dff_file(entry.path())) {
+            continue;
+        }
+        jobs.push_back({ entry.path().string(), make_output_file(entry.path(), std::filesystem::relative(entry.path(), dir), output_dir, export_options) });
+    }
+
+    if (error) {
+        std::cout << "directory: " << dir.string() << " reading error: " << error.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// the deepest directory holding every input, the list outputs keep their path below it so equal names in different directories stay apart
+std::filesystem::path get_common_root(const std::vector<std::filesystem::path>& input_files)
+{
+    std::filesystem::path root;
+    for (size_t i = 0; i < input_files.size(); i++) {
+        const std::filesystem::path dir = input_files[i].parent_path();
+        if (i == 0) {
+            root = dir;
+            continue;
+        }
+
+        std::filesystem::path common;
+        auto root_it = root.begin();
+        for (auto dir_it = dir.begin(); root_it != root.end() && dir_it != dir.end() && *root_it == *dir_it; ++root_it, ++dir_it) {
+            common /= *dir_it;
+        }
+        root = common;
+    }
+    return root;
+}
+
+bool collect_jobs_from_list(const std::filesystem::path& list_file, const std::string& output_dir, const ExportOptions& export_options, std::vector<gta_to_ue::batch::Job>& jobs)
+{
+    std::ifstream ifs(list_file);
+    if (!ifs.is_open()) {
+        std::cout << "file: " << list_file.string() << " is not found" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> lines;
+    std::vector<std::filesystem::path> input_files;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        input_files.push_back(std::filesystem::absolute(line).lexically_normal());
+        lines.push_back(std::move(line));
+    }
+
+    const std::filesystem::path root = get_common_root(input_files);
+    for (size_t i = 0; i < lines.size(); i++) {
+        // inputs on different drives have no common root, they keep their whole path
+        const std::filesystem::path relative_path = root.empty() ? input_files[i].relative_path() : input_files[i].lexically_relative(root);
+        jobs.push_back({ lines[i], make_output_file(lines[i], relative_path, output_dir, export_options) });
+    }
+
+    return true;
+}
+
+// every output may only be written by one job, the workers would write it at the same time otherwise
+bool check_unique_outputs(const std::vector<gta_to_ue::batch::Job>& jobs)
+{
+    std::unordered_map<std::string, const gta_to_ue::batch::Job*> output_jobs;
+    bool unique = true;
+    for (const auto& job : jobs) {
+        const auto [it, added] = output_jobs.emplace(std::filesystem::path(job.output_file).lexically_normal().string(), &job);
+        if (!added) {
+            std::cout << "file: " << job.output_file << " is the output of both " << it->second->input_file << " and " << job.input_file << std::endl;
+            unique = false;
+        }
+    }
+    return unique;
+}
+
+bool gta_to_ue::batch::collect_jobs(const std::string& source, const std::string& output_dir, const ExportOptions& export_options, std::vector<Job>& jobs)
+{
+    const std::filesystem::path path(source);
+    const bool collected = std::filesystem::is_directory(path)
+        ? collect_jobs_from_dir(path, output_dir, export_options, jobs)
+        : collect_jobs_from_list(path, output_dir, export_options, jobs);
+
+    return collected && check_unique_outputs(jobs);
+}
+
+bool gta_to_ue::batch::collect_jobs(const gta_to_ue::img::Archive& archive, const std::string& pattern, const std::string& output_dir, const ExportOptions& export_options, std::vector<Job>& jobs)
+{
+    for (const auto& entry : archive.get_entries()) {
+        if (!gta_to_ue::img::match_name(pattern, entry.name)) {
+            continue;
+        }
+        std::filesystem::path output_file = std::filesystem::path(output_dir) / entry.name;
+        output_file.replace_extension(gta_to_ue::get_output_extension(export_options));
+        jobs.push_back({ entry.name, output_file.string(), archive.get_data(entry), entry.size });
+    }
+
+    return check_unique_outputs(jobs);
+}
+
+int32_t gta_to_ue::batch::run(const std::vector<Job>& jobs, const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers, cache::Manifest* manifest)
+{
+    std::mutex output_mutex;
+    std::atomic<int32_t> num_failed{ 0 };
+    std::atomic<int32_t> num_up_to_date{ 0 };
+    const uint64_t options_hash = manifest ? cache::get_options_hash(converting_options, export_options) : 0;
+
+    {
+        WorkerPool pool(num_workers);
+        for (const auto& job : jobs) {
+            pool.submit([&job, &converting_options, &export_options, &output_mutex, &num_failed, &num_up_to_date, manifest, options_hash] {
+                uint64_t key = 0;
+                bool has_key = false;
+                if (manifest) {
+                    uint64_t input_hash = 0;
+                    if (job.data) {
+                        input_hash = gta_to_ue::hash::xxh64(job.data, job.size);
+                        has_key = true;
+                    } else {
+                        has_key = manifest->get_input_hash(job.input_file, input_hash);
+                    }
+                    key = cache::get_key(input_hash, options_hash);
+
+                    // a skipped file still hands the textures of its last conversion to the txd extraction
+                    std::vector<txd::TextureReference> texture_references;
+                    if (has_key && manifest->is_up_to_date(job.output_file, key, &texture_references)) {
+                        txd::add_references(texture_references);
+                        num_up_to_date++;
+                        return;
+                    }
+                }
+
+                std::error_code error;
+                const std::filesystem::path output_path(job.output_file);
+                if (output_path.has_parent_path()) {
+                    std::filesystem::create_directories(output_path.parent_path(), error);
+                }
+
+                std::vector<txd::TextureReference> texture_references;
+                const ConvertingStatus status = job.data
+                    ? gta_to_ue::convert(job.data, job.size, job.input_file, job.output_file, converting_options, export_options, &texture_references)
+                    : gta_to_ue::convert(job.input_file, job.output_file, converting_options, export_options, &texture_references);
+                if (status != ConvertingStatus::ok) {
+                    num_failed++;
+                }
+
+                if (manifest) {
+                    if (status == ConvertingStatus::ok && has_key) {
+                        manifest->update(job.output_file, key, std::move(texture_references));
+                    } else {
+                        manifest->remove(job.output_file);
+                    }
+                }
+
+                std::lock_guard lock(output_mutex);
+                if (status == ConvertingStatus::ok) {
+                    std::cout << "[ok] " << job.input_file << " -> " << job.output_file << std::endl;
+                } else {
+                    std::cout << "[failed] " << job.input_file << ": " << gta_to_ue::to_string(status) << std::endl;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    if (manifest && !manifest->save()) {
+        std::cout << "conversion cache is not saved" << std::endl;
+    }
+
+    std::cout << "converted " << jobs.size() - num_failed - num_up_to_date << " of " << jobs.size() << " files";
+    if (num_up_to_date > 0) {
+        std::cout << ", " << num_up_to_date << " up to date";
+    }
+    if (num_failed > 0) {
+        std::cout << ", " << num_failed << " failed";
+    }
+    std::cout << std::endl;
+
+    return num_failed;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "cache.h"
+#include "common.h"
+#include "img.h"
+
+namespace gta_to_ue {
+    namespace batch {
+        struct Job
+        {
+            std::string input_file;
+            std::string output_file;
+            // set for inputs that are already in memory, e.g. img archive entries
+            const uint8_t* data{ nullptr };
+            size_t size{ 0 };
+        };
+
+        // list file outputs keep their path below the common directory of the inputs, collecting fails if two jobs would write the same output
+        bool collect_jobs(const std::string& source, const std::string& output_dir, const ExportOptions& export_options, std::vector<Job>& jobs);
+
+        // the archive must outlive the jobs
+        bool collect_jobs(const gta_to_ue::img::Archive& archive, const std::string& pattern, const std::string& output_dir, const ExportOptions& export_options, std::vector<Job>& jobs);
+
+        // returns the number of failed jobs, jobs whose output is up to date in the manifest are skipped
+        int32_t run(const std::vector<Job>& jobs, const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers, cache::Manifest* manifest = nullptr);
+    }
+}
@@ -0,0 +1,375 @@
+#include "bin.h"
+#include "output_stream.h"
+#include "quantize.h"
+#include "skin.h"
+
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+
+static_assert(std::endian::native == std::endian::little, ".dffbin is written with native byte order");
+
+enum : uint32_t
+{
+    MESH_HAS_SKELETON = 1 << 0,
+    MESH_SAME_SKELETON = 1 << 1,
+    MESH_QUANTIZED = 1 << 2,
+
+    GEOMETRY_HAS_SKELETON = 1 << 0,
+    GEOMETRY_INSTANCED = 1 << 1,
+
+    INSTANCE_MIRROR = 1 << 0
+};
+
+class StringTable
+{
+public:
+    uint32_t add(const std::string& in_string)
+    {
+        // names coming from fixed-size rw buffers carry trailing zeros
+        const std::string string(in_string.c_str());
+        if (const auto it = string_to_id.find(string); it != string_to_id.end()) {
+            return it->second;
+        }
+
+        const uint32_t id = static_cast<uint32_t>(offsets.size());
+        offsets.push_back(static_cast<uint32_t>(data.size()));
+        data.insert(data.end(), string.begin(), string.end());
+        data.push_back('\0');
+        string_to_id.emplace(string, id);
+        return id;
+    }
+
+    std::unordered_map<std::string, uint32_t> string_to_id;
+    std::vector<uint32_t> offsets;
+    std::vector<char> data;
+};
+
+template <typename T>
+void write_value(gta_to_ue::OutputStream& stream, const T& value)
+{
+    stream.write(&value, sizeof(T));
+}
+
+template <typename T>
+void write_array(gta_to_ue::OutputStream& stream, const std::vector<T>& values)
+{
+    stream.write(values.data(), values.size() * sizeof(T));
+}
+
+void write_padding(gta_to_ue::OutputStream& stream, size_t size)
+{
+    const char zeros[4] = {};
+    stream.write(zeros, (4 - size % 4) % 4);
+}
+
+template <typename T>
+void write_padded_array(gta_to_ue::OutputStream& stream, const std::vector<T>& values)
+{
+    write_array(stream, values);
+    write_padding(stream, values.size() * sizeof(T));
+}
+
+void write_vector(gta_to_ue::OutputStream& stream, const gta_to_ue::Vector3f& vector)
+{
+    write_value(stream, vector.x);
+    write_value(stream, vector.y);
+    write_value(stream, vector.z);
+}
+
+void write_skeleton_bones(gta_to_ue::OutputStream& stream, const gta_to_ue::Skeleton& skeleton)
+{
+    write_padded_array(stream, skeleton.bone_ids);
+    for (auto& transform : skeleton.inverse_matrices) {
+        write_vector(stream, transform.x_axis);
+        write_vector(stream, transform.y_axis);
+        write_vector(stream, transform.z_axis);
+        write_vector(stream, transform.pos);
+    }
+}
+
+// interleaves the component arrays of the stream through a small staging buffer
+template <typename Stream, size_t NumComponents>
+void write_stream(gta_to_ue::OutputStream& stream, const Stream& values, const std::vector<float>* const (&components)[NumComponents])
+{
+    constexpr size_t chunk_size = 256;
+    float chunk[chunk_size * NumComponents];
+    for (size_t begin = 0; begin < values.size(); begin += chunk_size) {
+        const size_t end = std::min(begin + chunk_size, values.size());
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < NumComponents; j++) {
+                chunk[(i - begin) * NumComponents + j] = (*components[j])[i];
+            }
+        }
+        stream.write(chunk, (end - begin) * NumComponents * sizeof(float));
+    }
+}
+
+void write_stream(gta_to_ue::OutputStream& stream, const gta_to_ue::Vector3Stream& values)
+{
+    const std::vector<float>* const components[] = { &values.x, &values.y, &values.z };
+    write_stream(stream, values, components);
+}
+
+void write_stream(gta_to_ue::OutputStream& stream, const gta_to_ue::Vector2Stream& values)
+{
+    const std::vector<float>* const components[] = { &values.x, &values.y };
+    write_stream(stream, values, components);
+}
+
+void export_header(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data, const StringTable& strings, const ExportOptions& export_options)
+{
+    uint32_t flags = 0;
+    if (export_options.quantize) {
+        flags |= MESH_QUANTIZED;
+    }
+    if (mesh_data.has_skeleton) {
+        flags |= MESH_HAS_SKELETON;
+    }
+    if (mesh_data.same_skeleton) {
+        flags |= MESH_SAME_SKELETON;
+    }
+
+    stream.write("DFFB", 4);
+    write_value(stream, gta_to_ue::bin::version);
+    write_value(stream, flags);
+    write_value(stream, static_cast<uint32_t>(strings.offsets.size()));
+    write_value(stream, static_cast<uint32_t>(strings.data.size()));
+    write_value(stream, static_cast<uint32_t>(mesh_data.frames.size()));
+    write_value(stream, static_cast<uint32_t>(mesh_data.bone_hierarchy.size()));
+    write_value(stream, static_cast<uint32_t>(mesh_data.materials.size()));
+    write_value(stream, static_cast<uint32_t>(mesh_data.geometries.size()));
+    write_value(stream, static_cast<uint32_t>(mesh_data.instances.size()));
+}
+
+void export_string_table(gta_to_ue::OutputStream& stream, const StringTable& strings)
+{
+    write_array(stream, strings.offsets);
+    write_array(stream, strings.data);
+    write_padding(stream, strings.data.size());
+}
+
+void export_frames(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data, StringTable& strings)
+{
+    for (auto& frame : mesh_data.frames) {
+        write_vector(stream, frame.x_axis);
+        write_vector(stream, frame.y_axis);
+        write_vector(stream, frame.z_axis);
+        write_vector(stream, frame.pos);
+        write_value(stream, frame.parent_frame_id);
+        write_value(stream, strings.add(frame.name));
+    }
+}
+
+void export_bone_hierarchy(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data)
+{
+    for (auto& bone : mesh_data.bone_hierarchy) {
+        write_value(stream, bone.frame_id);
+        write_value(stream, bone.parent_id);
+        write_value(stream, bone.max_frame_size);
+    }
+}
+
+void export_materials(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data, StringTable& strings)
+{
+    for (auto& material : mesh_data.materials) {
+        write_value(stream, material.index);
+        write_value(stream, strings.add(material.material_name));
+        write_value(stream, strings.add(material.diffuse_texture));
+        write_value(stream, strings.add(material.mask_texture));
+        write_value(stream, material.color.r);
+        write_value(stream, material.color.g);
+        write_value(stream, material.color.b);
+        write_value(stream, material.color.a);
+    }
+}
+
+void export_instances(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data)
+{
+    for (auto& instance : mesh_data.instances) {
+        write_value(stream, instance.geometry_id);
+        write_value(stream, instance.frame_id);
+        write_value(stream, instance.mirror ? INSTANCE_MIRROR : 0u);
+        write_value(stream, instance.scale);
+        write_value(stream, instance.bone_id);
+    }
+}
+
+void export_shared_skeleton(gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data)
+{
+    if (!mesh_data.same_skeleton) {
+        return;
+    }
+
+    const auto& skeleton = mesh_data.skeleton;
+    write_value(stream, static_cast<uint32_t>(skeleton.num_bones));
+    write_value(stream, static_cast<uint32_t>(skeleton.num_used_bones));
+    write_value(stream, static_cast<uint32_t>(skeleton.bone_ids.size()));
+    write_value(stream, static_cast<uint32_t>(skeleton.inverse_matrices.size()));
+    write_skeleton_bones(stream, skeleton);
+}
+
+// x, y, z interleaved like the float streams
+void write_quantized_positions(gta_to_ue::OutputStream& stream, const gta_to_ue::Vector3Stream& vertices, const gta_to_ue::quantize::Range (&ranges)[3])
+{
+    std::vector<uint16_t> components[3];
+    gta_to_ue::quantize::encode_unorm16(vertices.x, ranges[0], components[0]);
+    gta_to_ue::quantize::encode_unorm16(vertices.y, ranges[1], components[1]);
+    gta_to_ue::quantize::encode_unorm16(vertices.z, ranges[2], components[2]);
+
+    std::vector<uint16_t> positions(vertices.size() * 3);
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i * 3] = components[0][i];
+        positions[i * 3 + 1] = components[1][i];
+        positions[i * 3 + 2] = components[2][i];
+    }
+    write_padded_array(stream, positions);
+}
+
+void write_quantized_tex_coordinates(gta_to_ue::OutputStream& stream, const gta_to_ue::TexCoordinateSet& tex_coordinate_set, const gta_to_ue::quantize::Range (&ranges)[2])
+{
+    std::vector<uint16_t> components[2];
+    gta_to_ue::quantize::encode_unorm16(tex_coordinate_set.x, ranges[0], components[0]);
+    gta_to_ue::quantize::encode_unorm16(tex_coordinate_set.y, ranges[1], components[1]);
+
+    std::vector<uint16_t> tex_coordinates(tex_coordinate_set.size() * 2);
+    for (size_t i = 0; i < tex_coordinate_set.size(); i++) {
+        tex_coordinates[i * 2] = components[0][i];
+        tex_coordinates[i * 2 + 1] = components[1][i];
+    }
+    write_array(stream, tex_coordinates);
+}
+
+void export_geometry(gta_to_ue::OutputStream& stream, const gta_to_ue::Geometry& geometry, const ExportOptions& export_options)
+{
+    const auto& skeleton = geometry.skeleton;
+
+    uint32_t flags = 0;
+    if (geometry.has_skeleton) {
+        flags |= GEOMETRY_HAS_SKELETON;
+    }
+    if (geometry.is_instanced) {
+        flags |= GEOMETRY_INSTANCED;
+    }
+
+    write_value(stream, geometry.frame_id);
+    write_value(stream, geometry.lod_level);
+    write_value(stream, flags);
+    write_value(stream, static_cast<uint32_t>(geometry.vertices.size()));
+    write_value(stream, static_cast<uint32_t>(geometry.get_num_triangles()));
+    write_value(stream, static_cast<uint32_t>(geometry.indices.get_index_size()));
+    write_value(stream, static_cast<uint32_t>(geometry.tex_coordinate_sets.size()));
+    write_value(stream, static_cast<uint32_t>(geometry.has_skeleton ? skeleton.num_bones : 0));
+    write_value(stream, static_cast<uint32_t>(geometry.has_skeleton ? skeleton.num_used_bones : 0));
+    write_value(stream, static_cast<uint32_t>(geometry.has_skeleton ? skeleton.bone_ids.size() : 0));
+    write_value(stream, static_cast<uint32_t>(geometry.has_skeleton ? skeleton.inverse_matrices.size() : 0));
+    write_value(stream, static_cast<uint32_t>(geometry.morph_targets.size()));
+
+    gta_to_ue::skin::CompactSkin compact_skin;
+    if (geometry.has_skeleton) {
+        compact_skin = gta_to_ue::skin::compact(geometry);
+    }
+    write_value(stream, geometry.has_skeleton ? skeleton.rigid_bone_id : -1);
+    write_value(stream, static_cast<uint32_t>(compact_skin.num_influences));
+
+    if (export_options.quantize) {
+        using gta_to_ue::quantize::Range;
+        const Range position_ranges[3] = {
+            gta_to_ue::quantize::get_range(geometry.vertices.x),
+            gta_to_ue::quantize::get_range(geometry.vertices.y),
+            gta_to_ue::quantize::get_range(geometry.vertices.z)
+        };
+        std::vector<Range> tex_coordinate_ranges;
+        for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+            tex_coordinate_ranges.push_back(gta_to_ue::quantize::get_range(tex_coordinate_set.x));
+            tex_coordinate_ranges.push_back(gta_to_ue::quantize::get_range(tex_coordinate_set.y));
+        }
+        std::vector<uint8_t> normals;
+        gta_to_ue::quantize::encode_normals(geometry.normals, export_options.normal_bits, normals);
+        std::vector<uint8_t> indices;
+        gta_to_ue::quantize::encode_indices(geometry.indices, indices);
+
+        write_value(stream, static_cast<uint32_t>(export_options.normal_bits));
+        write_value(stream, static_cast<uint32_t>(indices.size()));
+        write_vector(stream, gta_to_ue::Vector3f(position_ranges[0].min, position_ranges[1].min, position_ranges[2].min));
+        write_vector(stream, gta_to_ue::Vector3f(position_ranges[0].max, position_ranges[1].max, position_ranges[2].max));
+        for (size_t i = 0; i < tex_coordinate_ranges.size(); i += 2) {
+            write_value(stream, tex_coordinate_ranges[i].min);
+            write_value(stream, tex_coordinate_ranges[i + 1].min);
+            write_value(stream, tex_coordinate_ranges[i].max);
+            write_value(stream, tex_coordinate_ranges[i + 1].max);
+        }
+
+        write_quantized_positions(stream, geometry.vertices, position_ranges);
+        write_padded_array(stream, normals);
+        for (size_t i = 0; i < geometry.tex_coordinate_sets.size(); i++) {
+            const Range ranges[2] = { tex_coordinate_ranges[i * 2], tex_coordinate_ranges[i * 2 + 1] };
+            write_quantized_tex_coordinates(stream, geometry.tex_coordinate_sets[i], ranges);
+        }
+        write_padded_array(stream, indices);
+    } else {
+        write_stream(stream, geometry.vertices);
+        write_stream(stream, geometry.normals);
+        for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+            write_stream(stream, tex_coordinate_set);
+        }
+
+        const size_t indices_size = geometry.indices.size() * geometry.indices.get_index_size();
+        stream.write(geometry.indices.data(), indices_size);
+        write_padding(stream, indices_size);
+    }
+    write_array(stream, geometry.material_ids);
+
+    if (geometry.has_skeleton) {
+        write_padded_array(stream, compact_skin.bone_indices);
+        write_padded_array(stream, compact_skin.weights);
+        write_skeleton_bones(stream, skeleton);
+    }
+
+    for (auto& morph_target : geometry.morph_targets) {
+        write_vector(stream, morph_target.delta_min);
+        write_vector(stream, morph_target.delta_max);
+        write_value(stream, static_cast<uint32_t>(morph_target.vertex_ids.size()));
+        write_array(stream, morph_target.vertex_ids);
+        write_array(stream, morph_target.deltas);
+        write_padding(stream, morph_target.deltas.size() * sizeof(int16_t));
+    }
+}
+
+StringTable build_string_table(const gta_to_ue::Mesh& mesh_data)
+{
+    StringTable strings;
+    for (auto& frame : mesh_data.frames) {
+        strings.add(frame.name);
+    }
+    for (auto& material : mesh_data.materials) {
+        strings.add(material.material_name);
+        strings.add(material.diffuse_texture);
+        strings.add(material.mask_texture);
+    }
+    return strings;
+}
+
+bool gta_to_ue::bin::export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options)
+{
+    const std::unique_ptr<gta_to_ue::FileOutputStream> stream = gta_to_ue::create_file_output_stream(export_options);
+    if (!stream->open(file_name)) {
+        return false;
+    }
+    gta_to_ue::OutputStream& ofs = *stream;
+
+    StringTable strings = build_string_table(mesh_data);
+
+    export_header(ofs, mesh_data, strings, export_options);
+    export_string_table(ofs, strings);
+    export_frames(ofs, mesh_data, strings);
+    export_bone_hierarchy(ofs, mesh_data);
+    export_materials(ofs, mesh_data, strings);
+    export_instances(ofs, mesh_data);
+    export_shared_skeleton(ofs, mesh_data);
+    for (auto& geometry : mesh_data.geometries) {
+        export_geometry(ofs, geometry, export_options);
+    }
+
+    return stream->close();
+}
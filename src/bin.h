@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace bin {
+        /*
+         * .dffbin layout, little-endian, every block is 4-byte aligned:
+         *  header: "DFFB", version, flags, num_strings, string_data_size, num_frames, num_bones, num_materials, num_geometries, num_instances
+         *  string table: uint32 offsets[num_strings], zero-terminated string data padded to 4 bytes
+         *  frames: { float axis_x[3], axis_y[3], axis_z[3], pos[3]; int32 parent_id; uint32 name }[num_frames]
+         *  bone hierarchy: { int32 frame_id, parent_id, max_frame_size }[num_bones]
+         *  materials: { int32 id; uint32 name, diffuse_texture, mask_texture; uint8 rgba[4] }[num_materials]
+         *  instances: { int32 geometry_id, frame_id; uint32 flags; float scale; int32 bone_id }[num_instances]
+         *  with the same skeleton flag, the skeleton shared by every skinned geometry (their own bone ids and matrices are empty):
+         *      { uint32 num_bones, num_used_bones, num_bone_ids, num_inverse_matrices }
+         *      uint8 bone_ids[num_bone_ids] padded to 4 bytes, float inverse_matrices[num_inverse_matrices * 12]
+         *  geometries: for every geometry
+         *      { int32 frame_id, lod_level; uint32 flags, num_vertices, num_triangles, index_size, num_tex_coordinate_sets,
+         *        num_bones, num_used_bones, num_bone_ids, num_inverse_matrices, num_morph_targets; int32 rigid_bone_id; uint32 num_influences }
+         *      float positions[num_vertices * 3], normals[num_vertices * 3]
+         *      float tex_coordinates[num_tex_coordinate_sets][num_vertices * 2]
+         *      uint16 or uint32 (index_size is 2 or 4) indices[num_triangles * 3] padded to 4 bytes, int32 material_ids[num_triangles]
+         *      if has skeleton: uint8 bone_indices[num_vertices * num_influences] padded to 4 bytes,
+         *                       uint8 weights[num_vertices * num_influences] padded to 4 bytes (w / 255, 255 in total per vertex),
+         *                       uint8 bone_ids[num_bone_ids] padded to 4 bytes, float inverse_matrices[num_inverse_matrices * 12]
+         *          a geometry bound to a single bone has a rigid_bone_id other than -1 and no influences: every vertex is bone_id with weight 1
+         *      morph targets: { float delta_min[3], delta_max[3]; uint32 num_deltas; uint32 vertex_ids[num_deltas];
+         *                       int16 deltas[num_deltas * 3] padded to 4 bytes }[num_morph_targets], see gta_to_ue::MorphTarget
+         * with the quantized flag (--quantize) the vertex streams and indices of every geometry are replaced by
+         *      { uint32 normal_bits, index_data_size; float position_min[3], position_max[3];
+         *        float tex_coordinate_ranges[num_tex_coordinate_sets][4] (min u, min v, max u, max v) }
+         *      uint16 positions[num_vertices * 3] padded to 4 bytes, value = min + q / 65535 * (max - min) per axis
+         *      int8 or int16 (normal_bits is 8 or 16) normals[num_vertices * 2] padded to 4 bytes, snorm octahedral x, y:
+         *          x = q.x / 127 or 32767 (y alike), z = 1 - |x| - |y|, if z < 0: x, y = (1 - |y|) * sign(x), (1 - |x|) * sign(y), normalize
+         *      uint16 tex_coordinates[num_tex_coordinate_sets][num_vertices * 2], value = min + q / 65535 * (max - min)
+         *      uint8 indices[index_data_size] padded to 4 bytes: a LEB128 varint per index holding the zigzag-encoded
+         *          difference to the previous index (the first to 0)
+         *  the material ids, skin and morph target blocks stay the same
+         * strings are referenced by their index in the string table
+         * instanced geometries keep their vertices in the space of their frame, each instance places the
+         * geometry on frame_id, mirror and scale describe what is already baked into the geometry vertices.
+         * bone_id is the bone of frame_id and replaces the rigid_bone_id of the geometry for that instance
+         */
+        constexpr uint32_t version = 8;
+
+        // with zstd compression the whole file is one zstd frame
+        bool export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options);
+    }
+}
@@ -0,0 +1,238 @@
+#include "cache.h"
+#include "bin.h"
+#include "converter.h"
+#include "hash.h"
+#include "json.h"
+#include "mapped_file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+constexpr const char* manifest_header = "gta2ue-cache 2";
+
+template <typename T>
+void append_value(std::vector<uint8_t>& buffer, const T& value)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+uint64_t hash_file(const std::string& file_name)
+{
+    gta_to_ue::MappedFile file;
+    if (!file.open(file_name)) {
+        return 0;
+    }
+    return gta_to_ue::hash::xxh64(file.data(), file.size());
+}
+
+uint64_t gta_to_ue::cache::get_options_hash(const ConvertingOptions& converting_options, const ExportOptions& export_options)
+{
+    std::vector<uint8_t> buffer;
+    // a format version bump changes the output too, even when converter_version is forgotten
+    append_value(buffer, gta_to_ue::converter_version);
+    append_value(buffer, gta_to_ue::bin::version);
+    append_value(buffer, gta_to_ue::json::version);
+
+    append_value(buffer, converting_options.is_car);
+    append_value(buffer, converting_options.wheel_scale);
+    append_value(buffer, converting_options.wheel_id);
+    append_value(buffer, converting_options.optimize);
+    append_value(buffer, converting_options.lod_ratios.size());
+    for (const float ratio : converting_options.lod_ratios) {
+        append_value(buffer, ratio);
+    }
+    append_value(buffer, converting_options.morph_threshold);
+    // only the wheels content matters, the same file under another path gives the same output
+    append_value(buffer, converting_options.wheels_dff.empty() ? 0 : hash_file(converting_options.wheels_dff));
+
+    append_value(buffer, export_options.format);
+    append_value(buffer, export_options.json_layout);
+    append_value(buffer, export_options.compression);
+    append_value(buffer, export_options.compression_level);
+    append_value(buffer, export_options.quantize);
+    append_value(buffer, export_options.normal_bits);
+
+    return gta_to_ue::hash::xxh64(buffer.data(), buffer.size());
+}
+
+uint64_t gta_to_ue::cache::get_key(uint64_t input_hash, uint64_t options_hash)
+{
+    const uint64_t values[2] = { input_hash, options_hash };
+    return gta_to_ue::hash::xxh64(values, sizeof(values));
+}
+
+bool gta_to_ue::cache::Manifest::get_file_stamp(const std::string& file, FileStamp& stamp)
+{
+    std::error_code error;
+    const std::filesystem::path path(file);
+    stamp.size = std::filesystem::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    stamp.write_time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    return !error;
+}
+
+std::string gta_to_ue::cache::Manifest::get_path_key(const std::string& file)
+{
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::absolute(file, error);
+    return (error ? std::filesystem::path(file) : path).lexically_normal().generic_string();
+}
+
+void gta_to_ue::cache::Manifest::load(const std::string& dir)
+{
+    manifest_file = (std::filesystem::path(dir) / manifest_file_name).string();
+
+    std::ifstream ifs(manifest_file);
+    std::string line;
+    if (!std::getline(ifs, line) || line != manifest_header) {
+        return;
+    }
+
+    // i <size> <write time> <hash> <input path>
+    // o <size> <write time> <key> <output path>
+    // t <diffuse texture>\t<mask texture>, a texture reference of the output above
+    OutputEntry* output = nullptr;
+    while (std::getline(ifs, line)) {
+        if (line.starts_with("t ")) {
+            const size_t separator = line.find('\t', 2);
+            if (output && separator != std::string::npos) {
+                output->texture_references.push_back(txd::TextureReference{ line.substr(2, separator - 2), line.substr(separator + 1) });
+            }
+            continue;
+        }
+
+        output = nullptr;
+        std::istringstream s(line);
+        char type = 0;
+        FileStamp stamp;
+        uint64_t value = 0;
+        std::string path;
+        s >> type >> stamp.size >> stamp.write_time >> std::hex >> value;
+        s.get();
+        if (!s || !std::getline(s, path) || path.empty()) {
+            continue;
+        }
+
+        if (type == 'i') {
+            inputs[path] = InputEntry{ stamp, value };
+        } else if (type == 'o') {
+            output = &outputs[path];
+            *output = OutputEntry{ stamp, value };
+        }
+    }
+}
+
+bool gta_to_ue::cache::Manifest::save()
+{
+    std::lock_guard lock(mutex);
+
+    // written next to the manifest and renamed over it, so a crash or a concurrent run never leaves a torn file
+    std::random_device random;
+    const std::string temp_file = manifest_file + "." + std::to_string(random()) + ".tmp";
+    {
+        std::ofstream ofs(temp_file, std::ios::trunc);
+        if (!ofs.is_open()) {
+            std::cout << "file: " << temp_file << " can't be written" << std::endl;
+            return false;
+        }
+
+        ofs << manifest_header << "\n";
+        for (const auto& [path, entry] : inputs) {
+            ofs << "i " << entry.stamp.size << " " << entry.stamp.write_time << " " << std::hex << entry.hash << std::dec << " " << path << "\n";
+        }
+        for (const auto& [path, entry] : outputs) {
+            ofs << "o " << entry.stamp.size << " " << entry.stamp.write_time << " " << std::hex << entry.key << std::dec << " " << path << "\n";
+            for (const auto& reference : entry.texture_references) {
+                ofs << "t " << reference.diffuse_texture << "\t" << reference.mask_texture << "\n";
+            }
+        }
+
+        if (!ofs.flush()) {
+            std::cout << "file: " << temp_file << " writing error" << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_file, manifest_file, error);
+    if (error) {
+        std::cout << "file: " << manifest_file << " can't be replaced: " << error.message() << std::endl;
+        std::filesystem::remove(temp_file, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool gta_to_ue::cache::Manifest::get_input_hash(const std::string& input_file, uint64_t& hash)
+{
+    FileStamp stamp;
+    if (!get_file_stamp(input_file, stamp)) {
+        return false;
+    }
+
+    const std::string path = get_path_key(input_file);
+    {
+        std::lock_guard lock(mutex);
+        if (const auto it = inputs.find(path); it != inputs.end() && it->second.stamp == stamp) {
+            hash = it->second.hash;
+            return true;
+        }
+    }
+
+    gta_to_ue::MappedFile file;
+    if (!file.open(input_file)) {
+        return false;
+    }
+    hash = gta_to_ue::hash::xxh64(file.data(), file.size());
+
+    std::lock_guard lock(mutex);
+    inputs[path] = InputEntry{ stamp, hash };
+    return true;
+}
+
+bool gta_to_ue::cache::Manifest::is_up_to_date(const std::string& output_file, uint64_t key, std::vector<txd::TextureReference>* texture_references)
+{
+    FileStamp stamp;
+    if (!get_file_stamp(output_file, stamp)) {
+        return false;
+    }
+
+    const std::string path = get_path_key(output_file);
+    std::lock_guard lock(mutex);
+    const auto it = outputs.find(path);
+    if (it == outputs.end() || it->second.key != key || it->second.stamp != stamp) {
+        return false;
+    }
+
+    if (texture_references) {
+        *texture_references = it->second.texture_references;
+    }
+    return true;
+}
+
+void gta_to_ue::cache::Manifest::update(const std::string& output_file, uint64_t key, std::vector<txd::TextureReference> texture_references)
+{
+    FileStamp stamp;
+    if (!get_file_stamp(output_file, stamp)) {
+        remove(output_file);
+        return;
+    }
+
+    const std::string path = get_path_key(output_file);
+    std::lock_guard lock(mutex);
+    outputs[path] = OutputEntry{ stamp, key, std::move(texture_references) };
+}
+
+void gta_to_ue::cache::Manifest::remove(const std::string& output_file)
+{
+    const std::string path = get_path_key(output_file);
+    std::lock_guard lock(mutex);
+    outputs.erase(path);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "txd.h"
+
+namespace gta_to_ue {
+    namespace cache {
+        constexpr const char* manifest_file_name = ".gta2ue-cache";
+
+        // hash of everything besides the input bytes that changes the output: the converting and export options,
+        // the wheels dff bytes and the converter and format versions
+        uint64_t get_options_hash(const ConvertingOptions& converting_options, const ExportOptions& export_options);
+
+        uint64_t get_key(uint64_t input_hash, uint64_t options_hash);
+
+        /*
+         * incremental conversion manifest, maps every output file to the key it was converted with.
+         * an output is up to date while its key matches and the file still has the recorded size and write time.
+         * input hashes are remembered with the size and write time of the input so unchanged files are not read again.
+         * every output keeps the texture references of its materials, so a skipped file still adds them to a txd extraction.
+         * all methods are safe to call from several workers, the manifest is written with save() at the end of the run
+         */
+        class Manifest
+        {
+        public:
+            // a missing or unreadable manifest is an empty one
+            void load(const std::string& dir);
+            bool save();
+
+            // returns false if the input file can't be read
+            bool get_input_hash(const std::string& input_file, uint64_t& hash);
+
+            // texture_references receives the references recorded with an up-to-date output
+            bool is_up_to_date(const std::string& output_file, uint64_t key, std::vector<txd::TextureReference>* texture_references = nullptr);
+            void update(const std::string& output_file, uint64_t key, std::vector<txd::TextureReference> texture_references = {});
+            void remove(const std::string& output_file);
+
+        private:
+            struct FileStamp
+            {
+                uint64_t size{ 0 };
+                int64_t write_time{ 0 };
+
+                bool operator == (const FileStamp& other) const = default;
+            };
+
+            struct InputEntry
+            {
+                FileStamp stamp;
+                uint64_t hash{ 0 };
+            };
+
+            struct OutputEntry
+            {
+                FileStamp stamp;
+                uint64_t key{ 0 };
+                std::vector<txd::TextureReference> texture_references;
+            };
+
+            static bool get_file_stamp(const std::string& file, FileStamp& stamp);
+            static std::string get_path_key(const std::string& file);
+
+            std::string manifest_file;
+            std::mutex mutex;
+            std::unordered_map<std::string, InputEntry> inputs;
+            std::unordered_map<std::string, OutputEntry> outputs;
+        };
+    }
+}
@@ -1,7 +1,12 @@
 #include "car.h"
+#include <algorithm>
+#include <array>
 #include <map>
+#include <string_view>
 
-const std::vector<std::string> bone_names = {
+// the frames turned into bones of a car. chassis_dummy and extra1 were merged into one name by a missing comma until
+// converter version 4, so the cars holding them gained two bones then
+constexpr std::string_view bone_names[] = {
 	"wheel_rf_dummy",
 	"wheel_rm_dummy",
 	"wheel_rb_dummy",
@@ -26,7 +31,7 @@ const std::vector<std::string> bone_names = {
 	"headlights",
 	"taillights",
 	"exhaust",
-	"chassis_dummy"
+	"chassis_dummy",
 	"extra1",
 	"extra2",
 	"extra3",
@@ -35,6 +40,59 @@ const std::vector<std::string> bone_names = {
 	"extra6"
 };
 
+// perfect hash of the bone names: fnv-1a with a seed searched at compile time so every name gets its own slot
+constexpr uint32_t bone_name_slots = 128;
+constexpr uint32_t max_bone_name_seed = 4096;
+
+constexpr uint32_t hash_bone_name(std::string_view name, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ seed;
+	for (const char c : name) {
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+	}
+	return hash % bone_name_slots;
+}
+
+constexpr uint32_t find_bone_name_seed()
+{
+	for (uint32_t seed = 0; seed < max_bone_name_seed; seed++) {
+		bool used[bone_name_slots] = {};
+		bool collision = false;
+		for (const std::string_view name : bone_names) {
+			const uint32_t slot = hash_bone_name(name, seed);
+			collision = collision || used[slot];
+			used[slot] = true;
+		}
+		if (!collision) {
+			return seed;
+		}
+	}
+	return max_bone_name_seed;
+}
+
+constexpr uint32_t bone_name_seed = find_bone_name_seed();
+static_assert(bone_name_seed < max_bone_name_seed, "no collision-free seed for the bone names, grow bone_name_slots");
+
+constexpr std::array<int8_t, bone_name_slots> build_bone_name_table()
+{
+	std::array<int8_t, bone_name_slots> table{};
+	table.fill(-1);
+	for (size_t i = 0; i < std::size(bone_names); i++) {
+		table[hash_bone_name(bone_names[i], bone_name_seed)] = static_cast<int8_t>(i);
+	}
+	return table;
+}
+
+constexpr std::array<int8_t, bone_name_slots> bone_name_table = build_bone_name_table();
+
+bool is_bone_name(const std::string& frame_name)
+{
+	// names coming from fixed-size rw buffers may carry trailing zeros
+	const std::string_view name(frame_name.c_str());
+	const int8_t id = bone_name_table[hash_bone_name(name, bone_name_seed)];
+	return id != -1 && bone_names[id] == name;
+}
+
 const struct
 {
 	int32_t id;
@@ -53,86 +111,143 @@ const struct
 };
 
 
-void clear_geometry_and_frames(gta_to_ue::Mesh& mesh)
-{
-	auto delete_geometry_lambda = [&frames = mesh.frames](const gta_to_ue::Geometry& geometry) {
-		return frames[geometry.frame_id].name.ends_with("_lo") || frames[geometry.frame_id].name.ends_with("_vlo");
-	};
-
-	mesh.geometries.erase(std::remove_if(mesh.geometries.begin(), mesh.geometries.end(), delete_geometry_lambda), mesh.geometries.end());
-}
-
-void build_skeleton(gta_to_ue::Mesh& mesh, std::map<int32_t, int32_t>& frame_to_bone)
+// frame_bones maps every frame to the bone it is attached to: its own, the one of the closest bone ancestor or the root.
+// every geometry is rigidly bound to that bone and the bones are shared through the mesh skeleton
+void build_skeleton(gta_to_ue::Mesh& mesh, const std::vector<int32_t>& frame_bones)
 {
-	std::vector<gta_to_ue::BoneHierarchy> bones(mesh.frames.size());
 	mesh.has_skeleton = true;
 	mesh.same_skeleton = true;
 
+	auto& skeleton = mesh.skeleton;
+	skeleton.num_bones = mesh.bone_hierarchy.size();
+	skeleton.num_used_bones = mesh.bone_hierarchy.size();
+	skeleton.bone_ids.clear();
+	skeleton.inverse_matrices.clear();
+	skeleton.bone_ids.reserve(mesh.bone_hierarchy.size());
+	skeleton.inverse_matrices.reserve(mesh.bone_hierarchy.size());
+	for (int32_t i = 0; i < skeleton.num_bones; i++) {
+		skeleton.bone_ids.push_back(i);
+		skeleton.inverse_matrices.emplace_back(
+			gta_to_ue::Vector3f(1.f, 0.f, 0.f),
+			gta_to_ue::Vector3f(0.f, 1.f, 0.f),
+			gta_to_ue::Vector3f(0.f, 0.f, 1.f),
+			gta_to_ue::Vector3f(0.f, 0.f, 1.f)
+		);
+	}
+
 	for (auto& geometry : mesh.geometries) {
 		geometry.has_skeleton = true;
 
-		auto& skeleton = geometry.skeleton;
-		skeleton.num_bones = mesh.bone_hierarchy.size();
-		skeleton.num_used_bones = mesh.bone_hierarchy.size();
-
-		skeleton.weights.reserve(geometry.vertices.size());
-		skeleton.bone_indices.reserve(geometry.vertices.size());
-		for (int32_t i = 0; i < geometry.vertices.size(); i++) {
-			int32_t frame_id = geometry.frame_id;
-			while (true) {
-				if (std::find(bone_names.begin(), bone_names.end(), mesh.frames[frame_id].name) == bone_names.end()) {
-					frame_id = mesh.frames[frame_id].parent_frame_id;
-					if (frame_id == -1) {
-						frame_id = 0;
-						break;
-					}
-				} else {
-					break;
-				}
+		const int32_t bone_id = frame_bones[geometry.frame_id];
+		const size_t num_vertices = geometry.vertices.size();
+
+		if (!geometry.is_instanced) {
+			const gta_to_ue::Vector3f& pos = mesh.frames[mesh.bone_hierarchy[bone_id].frame_id].pos;
+			for (size_t i = 0; i < num_vertices; i++) {
+				geometry.vertices.x[i] += pos.x;
+				geometry.vertices.y[i] -= pos.y;
+				geometry.vertices.z[i] += pos.z;
 			}
-			
-			geometry.vertices[i] = geometry.vertices[i] + mesh.frames[frame_id].pos;
-			skeleton.weights.push_back(gta_to_ue::VertexWeight{ 1.f, 0.f, 0.f, 0.f });
-			skeleton.bone_indices.push_back(gta_to_ue::BoneIndex{ static_cast<uint8_t>(frame_to_bone[frame_id]), 0, 0, 0});
 		}
 
-		skeleton.bone_ids.reserve(mesh.bone_hierarchy.size());
-		skeleton.inverse_matrices.reserve(mesh.bone_hierarchy.size());
-		for (int32_t i = 0; i < skeleton.num_bones; i++) {
-			skeleton.bone_ids.push_back(i);
-			skeleton.inverse_matrices.emplace_back(
-				gta_to_ue::Vector3f(1.f, 0.f, 0.f),
-				gta_to_ue::Vector3f(0.f, 1.f, 0.f),
-				gta_to_ue::Vector3f(0.f, 0.f, 1.f),
-				gta_to_ue::Vector3f(0.f, 0.f, 1.f)
-			);
-		}
+		geometry.skeleton = gta_to_ue::Skeleton{};
+		geometry.skeleton.num_bones = skeleton.num_bones;
+		geometry.skeleton.num_used_bones = skeleton.num_used_bones;
+		geometry.skeleton.rigid_bone_id = bone_id;
 	}
+
+	// an instanced geometry is bound to the bone of each dummy it is placed on, not only to the one of its first dummy
+	for (auto& instance : mesh.instances) {
+		instance.bone_id = frame_bones[instance.frame_id];
+	}
+}
+
+int32_t resolve_frame_bone(const gta_to_ue::Mesh& mesh, std::vector<int32_t>& frame_bones, int32_t frame_id)
+{
+	if (frame_bones[frame_id] == -1) {
+		const int32_t parent_frame_id = mesh.frames[frame_id].parent_frame_id;
+		frame_bones[frame_id] = parent_frame_id == -1 ? 0 : resolve_frame_bone(mesh, frame_bones, parent_frame_id);
+	}
+	return frame_bones[frame_id];
 }
 
 void build_hierarchy(gta_to_ue::Mesh& mesh)
 {
 	std::vector<gta_to_ue::BoneHierarchy> bones;
 	bones.reserve(mesh.frames.size());
-	std::map<int32_t, int32_t> frame_to_bone;
+	std::vector<int32_t> frame_bones(mesh.frames.size(), -1);
 	
 	bones.emplace_back(gta_to_ue::BoneHierarchy(0, -1));
-	frame_to_bone[0] = 0;
-	int32_t bone_idx = 1;
+	frame_bones[0] = 0;
 	for (int32_t i = 1; i < mesh.frames.size(); i++) {
-		if (std::find(bone_names.begin(), bone_names.end(), mesh.frames[i].name) != bone_names.end()) {
+		if (is_bone_name(mesh.frames[i].name)) {
+			frame_bones[i] = bones.size();
 			bones.emplace_back(gta_to_ue::BoneHierarchy(i, 0));
-			frame_to_bone[i] = bone_idx;
-			bone_idx++;
 		}
 	}
 
+	for (int32_t i = 1; i < mesh.frames.size(); i++) {
+		resolve_frame_bone(mesh, frame_bones, i);
+	}
+
 	mesh.bone_hierarchy = std::move(bones);
 
-	build_skeleton(mesh, frame_to_bone);
+	build_skeleton(mesh, frame_bones);
+}
+
+// adds the wheel geometry once and places it on every found dummy frame
+void add_wheel_instances(gta_to_ue::Mesh& mesh, gta_to_ue::Geometry geometry, std::initializer_list<int32_t> frame_ids, bool mirror, float scale)
+{
+	int32_t geometry_id = -1;
+	for (const int32_t frame_id : frame_ids) {
+		if (frame_id == -1) {
+			continue;
+		}
+
+		if (geometry_id == -1) {
+			geometry.frame_id = frame_id;
+			geometry.is_instanced = true;
+			geometry_id = mesh.geometries.size();
+			mesh.geometries.push_back(std::move(geometry));
+		}
+
+		mesh.instances.push_back(gta_to_ue::GeometryInstance{ geometry_id, frame_id, mirror, scale });
+	}
+}
+
+// scales one axis of the quantized morph deltas like the positions. the box is centered on (max + min) / 2, so a negative
+// scale (the mirrored side) swaps its bounds and negates the quantized values
+void scale_morph_axis(float& delta_min, float& delta_max, std::vector<int16_t>& deltas, size_t axis, float scale)
+{
+	const float min = delta_min * scale;
+	const float max = delta_max * scale;
+	delta_min = std::min(min, max);
+	delta_max = std::max(min, max);
+	if (scale < 0.f) {
+		for (size_t i = axis; i < deltas.size(); i += 3) {
+			deltas[i] = static_cast<int16_t>(-deltas[i]);
+		}
+	}
+}
+
+void scale_morph_targets(gta_to_ue::Geometry& geometry, const gta_to_ue::Vector3f& scale)
+{
+	for (auto& morph_target : geometry.morph_targets) {
+		scale_morph_axis(morph_target.delta_min.x, morph_target.delta_max.x, morph_target.deltas, 0, scale.x);
+		scale_morph_axis(morph_target.delta_min.y, morph_target.delta_max.y, morph_target.deltas, 1, scale.y);
+		scale_morph_axis(morph_target.delta_min.z, morph_target.delta_max.z, morph_target.deltas, 2, scale.z);
+	}
+}
+
+gta_to_ue::WheelMesh::WheelMesh(gta_to_ue::Mesh in_mesh) : mesh(std::move(in_mesh))
+{
+	for (int32_t i = 0; i < mesh.geometries.size(); i++) {
+		// the first geometry wins, like the scan it replaces
+		geometry_ids.emplace(mesh.frames[mesh.geometries[i].frame_id].name, i);
+	}
 }
 
-void gta_to_ue::mixin_car_wheel(const ConvertingOptions& converting_options, Mesh& mesh, Mesh& wheel_mesh)
+void gta_to_ue::mixin_car_wheel(const ConvertingOptions& converting_options, Mesh& mesh, const WheelMesh& wheel_mesh)
 {
 	int32_t wheel_rf_dummy = -1;
 	int32_t	wheel_rb_dummy = -1;
@@ -170,69 +285,46 @@ void gta_to_ue::mixin_car_wheel(const ConvertingOptions& converting_options, Mes
 		}
 	}
 
-	for (auto& geometry : wheel_mesh.geometries) {
-		if (wheel_mesh.frames[geometry.frame_id].name == wheel_name) {
-			//copy materials
-			std::map<int32_t, int32_t> trimat_to_global;
-			for (auto& triangle : geometry.triangles) {
-				if (trimat_to_global.count(triangle.material_id) == 0) {
-					mesh.materials.push_back(wheel_mesh.materials[triangle.material_id]);
-					mesh.materials.back().index = mesh.materials.size() - 1;
-					trimat_to_global[triangle.material_id] = mesh.materials.size() - 1;
-				}
-				triangle.material_id = trimat_to_global[triangle.material_id];
-			}
-
-			gta_to_ue::Geometry r_geometry(geometry);
-			gta_to_ue::Geometry l_geometry(geometry);
-
-			for (int32_t i = 0; i < geometry.vertices.size(); i++) {
-				r_geometry.vertices[i].x *= converting_options.wheel_scale;
-				r_geometry.vertices[i].y *= converting_options.wheel_scale;
-				r_geometry.vertices[i].z *= converting_options.wheel_scale;
-
-				l_geometry.vertices[i].x *= converting_options.wheel_scale;
-				l_geometry.vertices[i].y *= -converting_options.wheel_scale;
-				l_geometry.vertices[i].z *= converting_options.wheel_scale;
-			}
+	const auto wheel_geometry = wheel_mesh.geometry_ids.find(wheel_name);
+	if (wheel_geometry == wheel_mesh.geometry_ids.end()) {
+		return;
+	}
 
-			if (wheel_rf_dummy != -1) {
-				r_geometry.frame_id = wheel_rf_dummy;
-				mesh.geometries.push_back(r_geometry);
-			}
+	gta_to_ue::Geometry r_geometry(wheel_mesh.mesh.geometries[wheel_geometry->second]);
 
-			if (wheel_rb_dummy != -1) {
-				r_geometry.frame_id = wheel_rb_dummy;
-				mesh.geometries.push_back(r_geometry);
-			}
+	//copy materials
+	std::map<int32_t, int32_t> trimat_to_global;
+	for (auto& material_id : r_geometry.material_ids) {
+		if (trimat_to_global.count(material_id) == 0) {
+			gta_to_ue::Material material = wheel_mesh.mesh.materials[material_id];
+			material.index = mesh.materials.size();
+			trimat_to_global[material_id] = mesh.materials.add_material(std::move(material));
+		}
+		material_id = trimat_to_global[material_id];
+	}
 
-			if (wheel_rm_dummy != -1) {
-				r_geometry.frame_id = wheel_rm_dummy;
-				mesh.geometries.push_back(r_geometry);
-			}
+	gta_to_ue::Geometry l_geometry(r_geometry);
 
-			if (wheel_lm_dummy != -1) {
-				l_geometry.frame_id = wheel_lm_dummy;
-				mesh.geometries.push_back(l_geometry);
-			}
+	for (int32_t i = 0; i < r_geometry.vertices.size(); i++) {
+		r_geometry.vertices.x[i] *= converting_options.wheel_scale;
+		r_geometry.vertices.y[i] *= converting_options.wheel_scale;
+		r_geometry.vertices.z[i] *= converting_options.wheel_scale;
 
-			if (wheel_lf_dummy != -1) {
-				l_geometry.frame_id = wheel_lf_dummy;
-				mesh.geometries.push_back(l_geometry);
-			}
+		l_geometry.vertices.x[i] *= converting_options.wheel_scale;
+		l_geometry.vertices.y[i] *= -converting_options.wheel_scale;
+		l_geometry.vertices.z[i] *= converting_options.wheel_scale;
+	}
 
-			if (wheel_lb_dummy != -1) {
-				l_geometry.frame_id = wheel_lb_dummy;
-				mesh.geometries.push_back(l_geometry);
-			}
+	// the morph deltas move the scaled and mirrored vertices, so they are scaled and mirrored the same way
+	const float wheel_scale = converting_options.wheel_scale;
+	scale_morph_targets(r_geometry, gta_to_ue::Vector3f(wheel_scale, wheel_scale, wheel_scale));
+	scale_morph_targets(l_geometry, gta_to_ue::Vector3f(wheel_scale, -wheel_scale, wheel_scale));
 
-			break;
-		}
-	}
+	add_wheel_instances(mesh, std::move(r_geometry), { wheel_rf_dummy, wheel_rb_dummy, wheel_rm_dummy }, false, converting_options.wheel_scale);
+	add_wheel_instances(mesh, std::move(l_geometry), { wheel_lm_dummy, wheel_lf_dummy, wheel_lb_dummy }, true, converting_options.wheel_scale);
 }
 
 void gta_to_ue::build_car(Mesh& mesh)
 {
-	clear_geometry_and_frames(mesh);
 	build_hierarchy(mesh);
 }
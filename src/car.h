@@ -4,6 +4,15 @@
 
 namespace gta_to_ue {
 
-	void mixin_car_wheel(const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh, gta_to_ue::Mesh& wheel_mesh);
+	// parsed wheels dff, indexed by the frame names of its geometries
+	struct WheelMesh
+	{
+		gta_to_ue::Mesh mesh;
+		std::unordered_map<std::string, int32_t> geometry_ids;
+
+		explicit WheelMesh(gta_to_ue::Mesh in_mesh);
+	};
+
+	void mixin_car_wheel(const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh, const WheelMesh& wheel_mesh);
 	void build_car(gta_to_ue::Mesh& mesh);
 }
\ No newline at end of file
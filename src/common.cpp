@@ -8,9 +8,118 @@ Vector3f::Vector3f(float in_x, float in_y, float in_z) : x(in_x), y(in_y), z(in_
 Vector2f::Vector2f(float in_x, float in_y) : x(in_x), y(in_y)
 {}
 
-Triangle::Triangle(float in_vertex1, float in_vertex2, float in_vertex3, int32_t in_material_id) :
-    vertex1(in_vertex1), vertex2(in_vertex2), vertex3(in_vertex3), material_id(in_material_id)
-{}
+size_t Vector2Stream::size() const
+{
+    return x.size();
+}
+
+void Vector2Stream::reserve(size_t num_elements)
+{
+    x.reserve(num_elements);
+    y.reserve(num_elements);
+}
+
+void Vector2Stream::resize(size_t num_elements)
+{
+    x.resize(num_elements);
+    y.resize(num_elements);
+}
+
+void Vector2Stream::push_back(const Vector2f& vector)
+{
+    x.push_back(vector.x);
+    y.push_back(vector.y);
+}
+
+size_t Vector3Stream::size() const
+{
+    return x.size();
+}
+
+void Vector3Stream::reserve(size_t num_elements)
+{
+    x.reserve(num_elements);
+    y.reserve(num_elements);
+    z.reserve(num_elements);
+}
+
+void Vector3Stream::resize(size_t num_elements)
+{
+    x.resize(num_elements);
+    y.resize(num_elements);
+    z.resize(num_elements);
+}
+
+void Vector3Stream::push_back(const Vector3f& vector)
+{
+    x.push_back(vector.x);
+    y.push_back(vector.y);
+    z.push_back(vector.z);
+}
+
+void IndexBuffer::reset(size_t num_vertices)
+{
+    wide = num_vertices > 0x10000;
+    indices16.clear();
+    indices32.clear();
+}
+
+void IndexBuffer::reserve(size_t num_indices)
+{
+    if (wide) {
+        indices32.reserve(num_indices);
+    } else {
+        indices16.reserve(num_indices);
+    }
+}
+
+void IndexBuffer::resize(size_t num_indices)
+{
+    if (wide) {
+        indices32.resize(num_indices);
+    } else {
+        indices16.resize(num_indices);
+    }
+}
+
+void IndexBuffer::push_back(uint32_t index)
+{
+    if (wide) {
+        indices32.push_back(index);
+    } else {
+        indices16.push_back(static_cast<uint16_t>(index));
+    }
+}
+
+size_t IndexBuffer::size() const
+{
+    return wide ? indices32.size() : indices16.size();
+}
+
+bool IndexBuffer::is_wide() const
+{
+    return wide;
+}
+
+size_t IndexBuffer::get_index_size() const
+{
+    return wide ? sizeof(uint32_t) : sizeof(uint16_t);
+}
+
+const void* IndexBuffer::data() const
+{
+    return wide ? static_cast<const void*>(indices32.data()) : static_cast<const void*>(indices16.data());
+}
+
+uint16_t* IndexBuffer::narrow_data()
+{
+    return indices16.data();
+}
+
+uint32_t* IndexBuffer::wide_data()
+{
+    return indices32.data();
+}
 
 Color::Color(uint8_t in_r, uint8_t in_g, uint8_t in_b, uint8_t in_a): r(in_r), g(in_g), b(in_b), a(in_a)
 {}
@@ -34,36 +143,70 @@ Material::Material(std::string in_material_name, std::string in_diffuse_texture,
 Geometry::Geometry(int32_t num_triangles_to_reserve, int32_t num_tex_coordinates_sets_to_reserve, int32_t in_num_vertices, int32_t in_num_materials, int32_t in_frame_id) :
     frame_id(in_frame_id), has_skeleton(false)
 {
-    triangles.reserve(num_triangles_to_reserve);
+    indices.reset(in_num_vertices);
+    indices.reserve(num_triangles_to_reserve * 3);
+    material_ids.reserve(num_triangles_to_reserve);
     tex_coordinate_sets.reserve(num_tex_coordinates_sets_to_reserve);
     vertices.reserve(in_num_vertices);
     normals.reserve(in_num_vertices);
     materials.reserve(in_num_materials);
 }
 
+size_t Geometry::get_num_triangles() const
+{
+    return material_ids.size();
+}
+
 Mesh::Mesh(): has_skeleton(false)
 {}
 
-bool MaterialArray::has_material_with_hash(size_t hash)
+bool MaterialArray::has_material_with_hash(size_t hash) const
 {
-    auto cmp_lambda = [hash](const Material& material) { return material.hash == hash; };
-    if (const auto result = std::ranges::find_if(*this, cmp_lambda); result == std::end(*this)) {
-        return false;
-    }
-
-    return true;
+    return hash_to_id.contains(hash);
 }
 
-int32_t MaterialArray::get_material_id_with_hash(size_t hash)
+int32_t MaterialArray::get_material_id_with_hash(size_t hash) const
 {
-    auto cmp_lambda = [hash](const gta_to_ue::Material& material) { return material.hash == hash; };
-    if (const auto result = std::ranges::find_if(*this, cmp_lambda); result != std::end(*this)) {
-        return result->index;
+    if (const auto result = hash_to_id.find(hash); result != hash_to_id.end()) {
+        return result->second;
     }
 
     return 0;
 }
 
+int32_t MaterialArray::add_material(Material material)
+{
+    const int32_t id = material.index;
+    hash_to_id.emplace(material.hash, id);
+    materials.push_back(std::move(material));
+    return id;
+}
+
+size_t MaterialArray::size() const
+{
+    return materials.size();
+}
+
+void MaterialArray::reserve(size_t capacity)
+{
+    materials.reserve(capacity);
+}
+
+const Material& MaterialArray::operator [] (size_t id) const
+{
+    return materials[id];
+}
+
+std::vector<Material>::const_iterator MaterialArray::begin() const
+{
+    return materials.begin();
+}
+
+std::vector<Material>::const_iterator MaterialArray::end() const
+{
+    return materials.end();
+}
+
 Frame::Frame(const Vector3f& in_x_axis, const Vector3f& in_y_axis, const Vector3f& in_z_axis, const Vector3f& in_pos, int32_t in_parent_frame_id, std::string in_name) :
     x_axis(in_x_axis), y_axis(in_y_axis), z_axis(in_z_axis), name(std::move(in_name)), pos(in_pos),
     parent_frame_id(in_parent_frame_id)
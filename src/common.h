@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <rw.h>
 #include <rwgta.h>
@@ -12,6 +13,40 @@ struct ConvertingOptions
     std::string wheels_dff{ "" };
     float wheel_scale{ 1.f };
     int32_t wheel_id{ 237 };
+    bool optimize{ false };
+    // triangle ratios of the generated lod levels, only used for models without *_lo/*_vlo geometries
+    std::vector<float> lod_ratios;
+    // morph target vertices moving at most this far (in output units) on every axis are left out of the target
+    float morph_threshold{ 0.01f };
+};
+
+enum class OutputFormat
+{
+    json,
+    bin
+};
+
+enum class JsonLayout
+{
+    objects,
+    compact
+};
+
+enum class Compression
+{
+    none,
+    zstd
+};
+
+struct ExportOptions
+{
+    OutputFormat format{ OutputFormat::json };
+    JsonLayout json_layout{ JsonLayout::objects };
+    Compression compression{ Compression::none };
+    int32_t compression_level{ 3 };
+    // bin only: 16-bit positions and uvs, octahedral normals with normal_bits (8 or 16) per component and varint indices
+    bool quantize{ false };
+    int32_t normal_bits{ 16 };
 };
 
 namespace gta_to_ue {
@@ -24,8 +59,6 @@ namespace gta_to_ue {
         Vector2f(float in_x, float in_y);
     };
 
-    using TexCoordinateSet = std::vector<Vector2f>;
-
     struct Vector3f
     {
         float x;
@@ -40,14 +73,77 @@ namespace gta_to_ue {
 		}
     };
 
-    struct Triangle
+    // structure-of-arrays vertex streams, one contiguous array per component
+    struct Vector2Stream
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+
+        size_t size() const;
+        void reserve(size_t num_elements);
+        void resize(size_t num_elements);
+        void push_back(const Vector2f& vector);
+
+        Vector2f operator [] (size_t i) const
+        {
+            return Vector2f(x[i], y[i]);
+        }
+    };
+
+    struct Vector3Stream
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+
+        size_t size() const;
+        void reserve(size_t num_elements);
+        void resize(size_t num_elements);
+        void push_back(const Vector3f& vector);
+
+        Vector3f operator [] (size_t i) const
+        {
+            return Vector3f(x[i], y[i], z[i]);
+        }
+    };
+
+    using TexCoordinateSet = Vector2Stream;
+
+    // triangle list vertex indices, stored as uint16_t when every vertex of the geometry is addressable with 16 bits
+    class IndexBuffer
     {
-        float vertex1;
-        float vertex2;
-        float vertex3;
-        int32_t material_id;
+    public:
+        void reset(size_t num_vertices);
+        void reserve(size_t num_indices);
+        void resize(size_t num_indices);
+        void push_back(uint32_t index);
+
+        uint32_t operator [] (size_t i) const
+        {
+            return wide ? indices32[i] : indices16[i];
+        }
+
+        void set(size_t i, uint32_t index)
+        {
+            if (wide) {
+                indices32[i] = index;
+            } else {
+                indices16[i] = static_cast<uint16_t>(index);
+            }
+        }
 
-        Triangle(float in_vertex1, float in_vertex2, float in_vertex3, int32_t in_material_id);
+        size_t size() const;
+        bool is_wide() const;
+        size_t get_index_size() const;
+        const void* data() const;
+
+        uint16_t* narrow_data();
+        uint32_t* wide_data();
+
+    private:
+        std::vector<uint16_t> indices16;
+        std::vector<uint32_t> indices32;
+        bool wide{ false };
     };
 
     struct Color
@@ -74,12 +170,27 @@ namespace gta_to_ue {
         Material(std::string in_material_name, std::string in_diffuse_texture, std::string in_mask_texture, const Color& in_color, size_t in_hash, int32_t in_index);
     };
 
-    class MaterialArray: public std::vector<Material>
+    // materials are only added through add_material, so the hash index always matches the contents
+    class MaterialArray
     {
     public:
-        bool has_material_with_hash(size_t hash);
+        bool has_material_with_hash(size_t hash) const;
+
+        int32_t get_material_id_with_hash(size_t hash) const;
+
+        // appends the material and indexes it by hash, returns its id
+        int32_t add_material(Material material);
+
+        size_t size() const;
+        void reserve(size_t capacity);
 
-        int32_t get_material_id_with_hash(size_t hash);
+        const Material& operator [] (size_t id) const;
+        std::vector<Material>::const_iterator begin() const;
+        std::vector<Material>::const_iterator end() const;
+
+    private:
+        std::vector<Material> materials;
+        std::unordered_map<size_t, int32_t> hash_to_id;
     };
 
     struct Frame
@@ -131,26 +242,60 @@ namespace gta_to_ue {
 
     struct Skeleton
     {
-        int32_t num_bones;
-        int32_t num_used_bones;
+        int32_t num_bones{ 0 };
+        int32_t num_used_bones{ 0 };
+        // a geometry bound to a single bone keeps only its id, bone_indices and weights are empty then
+        int32_t rigid_bone_id{ -1 };
         std::vector<uint8_t> bone_ids;
         std::vector<BoneIndex> bone_indices;
         std::vector<VertexWeight> weights;
         std::vector<BoneTransform> inverse_matrices;
     };
 
+    // sparse position deltas of a morph target against the base vertices of its geometry, only the moving vertices have an entry.
+    // the deltas are quantized to 16 bits inside their bounding box: delta = center + quantized / 32767 * extent,
+    // with center = (delta_max + delta_min) / 2 and extent = (delta_max - delta_min) / 2 per axis
+    struct MorphTarget
+    {
+        Vector3f delta_min{ 0.f, 0.f, 0.f };
+        Vector3f delta_max{ 0.f, 0.f, 0.f };
+        // ascending vertex ids of the entries
+        std::vector<uint32_t> vertex_ids;
+        // x, y, z of every entry
+        std::vector<int16_t> deltas;
+    };
+
     struct Geometry
     {
         MaterialArray materials;
-        std::vector<Triangle> triangles;
+        IndexBuffer indices;
+        std::vector<int32_t> material_ids;
         std::vector<TexCoordinateSet> tex_coordinate_sets;
-        std::vector<Vector3f> vertices;
-        std::vector<Vector3f> normals;
+        Vector3Stream vertices;
+        Vector3Stream normals;
+        // the targets after the base morph target of the rw geometry
+        std::vector<MorphTarget> morph_targets;
         bool has_skeleton;
+        // instanced geometries stay in the space of their frame and are placed through Mesh::instances
+        bool is_instanced{ false };
+        // 0 is the full detail geometry, every level above is a coarser version of the model
+        int32_t lod_level{ 0 };
         int32_t frame_id;
         Skeleton skeleton;
 
         Geometry(int32_t num_triangles_to_reserve, int32_t num_tex_coordinates_sets_to_reserve, int32_t in_num_vertices, int32_t in_num_materials, int32_t in_frame_id);
+
+        size_t get_num_triangles() const;
+    };
+
+    struct GeometryInstance
+    {
+        int32_t geometry_id;
+        int32_t frame_id;
+        bool mirror;
+        float scale;
+        // the bone of frame_id, it replaces the rigid bone of the instanced geometry for this placement
+        int32_t bone_id{ -1 };
     };
 
     struct Mesh
@@ -161,6 +306,9 @@ namespace gta_to_ue {
         MaterialArray materials;
         std::vector<BoneHierarchy> bone_hierarchy;
         std::vector<Frame> frames;
+        std::vector<GeometryInstance> instances;
+        // bone ids and inverse matrices of every skinned geometry when same_skeleton is set, the geometries keep only their skin
+        Skeleton skeleton;
 
         Mesh();
     };
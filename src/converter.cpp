@@ -0,0 +1,139 @@
+#include "converter.h"
+#include "bin.h"
+#include "dff.h"
+#include "json.h"
+#include "lod.h"
+#include "optimize.h"
+#include "profile.h"
+#include "txd.h"
+
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+
+const char* gta_to_ue::to_string(ConvertingStatus status)
+{
+    switch (status) {
+    case ConvertingStatus::ok:
+        return "ok";
+    case ConvertingStatus::parsing_error:
+        return "parsing error";
+    case ConvertingStatus::saving_error:
+        return "saving error";
+    }
+
+    return "unknown error";
+}
+
+const char* gta_to_ue::get_output_extension(const ExportOptions& export_options)
+{
+    if (export_options.compression == Compression::zstd) {
+        return export_options.format == OutputFormat::bin ? ".dffbin.zst" : ".dffjson.zst";
+    }
+    return export_options.format == OutputFormat::bin ? ".dffbin" : ".dffjson";
+}
+
+bool gta_to_ue::parse_compression(const std::string& compression, ExportOptions& export_options)
+{
+    if (compression == "none") {
+        export_options.compression = Compression::none;
+        return true;
+    }
+
+    const std::string method = compression.substr(0, compression.find(':'));
+    if (method != "zstd") {
+        return false;
+    }
+
+    int32_t level = 3;
+    if (method.size() < compression.size()) {
+        const std::string level_string = compression.substr(method.size() + 1);
+        const auto [end, error] = std::from_chars(level_string.data(), level_string.data() + level_string.size(), level);
+        if (error != std::errc() || end != level_string.data() + level_string.size() || level < 1 || level > 22) {
+            return false;
+        }
+    }
+
+    export_options.compression = Compression::zstd;
+    export_options.compression_level = level;
+    return true;
+}
+
+std::string gta_to_ue::get_default_output_file(const std::string& input_file, const ExportOptions& export_options)
+{
+    const std::filesystem::path path = std::filesystem::path(input_file);
+    const std::string ext = path.has_extension() ? path.extension().string() : "";
+    if (ext.empty()) {
+        return "";
+    }
+
+    return input_file.substr(0, input_file.length() - ext.length()) + get_output_extension(export_options);
+}
+
+gta_to_ue::ConvertingStatus export_mesh(gta_to_ue::Mesh& mesh, const std::string& input_file, const std::string& output_file, const ConvertingOptions& converting_options, const ExportOptions& export_options,
+    std::vector<gta_to_ue::txd::TextureReference>* texture_references)
+{
+    std::vector<gta_to_ue::txd::TextureReference> mesh_references = gta_to_ue::txd::get_references(mesh);
+    gta_to_ue::txd::add_references(mesh_references);
+    if (texture_references) {
+        *texture_references = std::move(mesh_references);
+    }
+
+    if (!converting_options.lod_ratios.empty()) {
+        const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::lods);
+        gta_to_ue::lod::generate_lods(mesh, converting_options.lod_ratios);
+    }
+
+    if (converting_options.optimize) {
+        const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::optimize);
+        const gta_to_ue::optimize::Stats stats = gta_to_ue::optimize::optimize_mesh(mesh);
+        std::ostringstream s;
+        s << "optimized " << input_file << ": vertices " << stats.num_vertices_before << " -> " << stats.num_vertices_after
+            << ", acmr " << stats.get_acmr_before() << " -> " << stats.get_acmr_after() << std::endl;
+        std::cout << s.str();
+    }
+
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::export_mesh);
+    const bool saved = export_options.format == OutputFormat::bin
+        ? gta_to_ue::bin::export_to_file(output_file, mesh, export_options)
+        : gta_to_ue::json::export_to_file(output_file, mesh, export_options);
+    if (!saved) {
+        return gta_to_ue::ConvertingStatus::saving_error;
+    }
+
+    return gta_to_ue::ConvertingStatus::ok;
+}
+
+gta_to_ue::ConvertingStatus gta_to_ue::convert(const std::string& input_file, const std::string& output_file, const ConvertingOptions& converting_options, const ExportOptions& export_options,
+    std::vector<txd::TextureReference>* texture_references)
+{
+    const profile::ScopedTimer timer(profile::Stage::file, input_file);
+    profile::add(profile::Counter::files, 1);
+
+    gta_to_ue::Mesh mesh;
+    rw::Clump* clump = gta_to_ue::dff::parse(input_file, converting_options, mesh);
+    if (!clump) {
+        return ConvertingStatus::parsing_error;
+    }
+
+    gta_to_ue::dff::destroy(clump);
+
+    return export_mesh(mesh, input_file, output_file, converting_options, export_options, texture_references);
+}
+
+gta_to_ue::ConvertingStatus gta_to_ue::convert(const uint8_t* data, size_t size, const std::string& input_name, const std::string& output_file, const ConvertingOptions& converting_options, const ExportOptions& export_options,
+    std::vector<txd::TextureReference>* texture_references)
+{
+    const profile::ScopedTimer timer(profile::Stage::file, input_name);
+    profile::add(profile::Counter::files, 1);
+
+    gta_to_ue::Mesh mesh;
+    rw::Clump* clump = gta_to_ue::dff::parse(data, size, input_name, converting_options, mesh);
+    if (!clump) {
+        return ConvertingStatus::parsing_error;
+    }
+
+    gta_to_ue::dff::destroy(clump);
+
+    return export_mesh(mesh, input_name, output_file, converting_options, export_options, texture_references);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common.h"
+#include "txd.h"
+
+namespace gta_to_ue {
+
+    // bumped whenever the same input and options give a different output, invalidates the conversion caches
+    constexpr uint32_t converter_version = 6;
+
+    enum class ConvertingStatus
+    {
+        ok,
+        parsing_error,
+        saving_error
+    };
+
+    const char* to_string(ConvertingStatus status);
+
+    const char* get_output_extension(const ExportOptions& export_options);
+
+    // "none", "zstd" or "zstd:<level>" with a level of 1 to 22
+    bool parse_compression(const std::string& compression, ExportOptions& export_options);
+
+    std::string get_default_output_file(const std::string& input_file, const ExportOptions& export_options);
+
+    // texture_references receives the textures of the converted materials, e.g. to keep them in the conversion cache
+    ConvertingStatus convert(const std::string& input_file, const std::string& output_file, const ConvertingOptions& converting_options, const ExportOptions& export_options,
+        std::vector<txd::TextureReference>* texture_references = nullptr);
+
+    // converts a dff held in memory, e.g. an img archive entry
+    ConvertingStatus convert(const uint8_t* data, size_t size, const std::string& input_name, const std::string& output_file, const ConvertingOptions& converting_options, const ExportOptions& export_options,
+        std::vector<txd::TextureReference>* texture_references = nullptr);
+}
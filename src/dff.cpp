@@ -1,9 +1,28 @@
 #include "dff.h"
 #include "car.h"
-
+#include "kernels.h"
+#include "lod.h"
+#include "mapped_file.h"
+#include "morph.h"
+#include "profile.h"
+#include "skin.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+// librw keeps texture dictionaries and plugin state in globals, so clump reading and destruction are serialized
+std::mutex rw_mutex;
+
+// smaller clumps aren't worth starting the workers for
+constexpr int32_t min_parallel_vertices = 8192;
+std::atomic<int32_t> num_atomic_workers{ 1 };
 
 gta_to_ue::Vector3f convert_vector_xyz(const ConvertingOptions& converting_options, float x, float y, float z, float multiplicator, bool negate_y = false)
 {
@@ -14,8 +33,13 @@ gta_to_ue::Vector3f convert_vector_xyz(const ConvertingOptions& converting_optio
 	return gta_to_ue::Vector3f(x * multiplicator, y * multiplicator, z * multiplicator);
 }
 
+// the rw skin arrays are read as VertexWeight and BoneIndex streams
+static_assert(sizeof(gta_to_ue::VertexWeight) == 4 * sizeof(float));
+static_assert(sizeof(gta_to_ue::BoneIndex) == 4 * sizeof(uint8_t));
+
 void parse_rw_skin_data(const rw::Geometry* geometry, int32_t geometry_id, gta_to_ue::Mesh& mesh_data)
 {
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::parse_skin);
     const rw::Skin* skin = rw::Skin::get(geometry);
     if (!skin) {
         return;
@@ -26,6 +50,7 @@ void parse_rw_skin_data(const rw::Geometry* geometry, int32_t geometry_id, gta_t
     mesh_data.same_skeleton = false;
 
     auto& skeleton = mesh_data.geometries[geometry_id].skeleton;
+    skeleton = gta_to_ue::Skeleton{};
 
     skeleton.num_bones = skin->numBones;
     skeleton.num_used_bones = skin->numUsedBones;
@@ -61,6 +86,8 @@ void parse_rw_skin_data(const rw::Geometry* geometry, int32_t geometry_id, gta_t
 
 void parse_rw_frames(const rw::FrameList_& frame_list, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data)
 {
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::parse_frames);
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::frames, frame_list.numFrames);
     mesh_data.frames.reserve(frame_list.numFrames);
     int32_t hierarchy_id = -1;
     std::map<int32_t, int32_t> bone_id_to_frame_id;
@@ -124,64 +151,111 @@ void parse_rw_frames(const rw::FrameList_& frame_list, const ConvertingOptions&
     mesh_data.bone_hierarchy = std::move(bones);
 }
 
-size_t get_hash_for_material(const rw::Material* material)
+MaterialIdTable parse_rw_materials(const rw::Geometry* geometry, gta_to_ue::Mesh& mesh_data, const std::string& filename)
 {
-    if (!material) {
-        return 0;
-    }
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::parse_materials);
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::materials, geometry->matList.numMaterials);
 
-    if (material->texture) {
-        const std::string diffuse_texture_name(material->texture->name, 32);
-        const std::string mask_texture_name(material->texture->mask, 32);
-        return std::hash<std::string>{}(diffuse_texture_name + mask_texture_name);
+    MaterialIdTable material_ids;
+    material_ids.reserve(geometry->matList.numMaterials);
+
+    for (int32_t i = 0; i < geometry->matList.numMaterials; i++)
+    {
+        const rw::Material* material = geometry->matList.materials[i];
+        const int32_t index = mesh_data.materials.size();
+        gta_to_ue::Color color(
+            material->color.red / 255.f,
+            material->color.green / 255.f,
+            material->color.blue / 255.f,
+            material->color.alpha / 255.f
+        );
+
+        std::string diffuse_texture_name;
+        std::string mask_texture_name;
+        size_t hash;
+        if (material->texture) {
+            diffuse_texture_name.assign(material->texture->name, 32);
+            mask_texture_name.assign(material->texture->mask, 32);
+            hash = std::hash<std::string>{}(diffuse_texture_name + mask_texture_name);
+        } else {
+            hash = std::hash<std::string>{}(color.to_string());
+        }
+
+        if (mesh_data.materials.has_material_with_hash(hash)) {
+            material_ids[material] = mesh_data.materials.get_material_id_with_hash(hash);
+            continue;
+        }
+
+        std::ostringstream s;
+        s << filename << "_" << index;
+        material_ids[material] = mesh_data.materials.add_material(
+            gta_to_ue::Material(s.str(), std::move(diffuse_texture_name), std::move(mask_texture_name), color, hash, index)
+        );
     }
 
-    const gta_to_ue::Color color(material->color.red, material->color.green, material->color.blue, material->color.alpha);
-    return  std::hash<std::string>{}(color.to_string());
+    return material_ids;
 }
 
-int32_t get_material_id(const rw::Material* material, gta_to_ue::Mesh& mesh_data)
+// cars swap x and y and mirror positions along the new y axis, see convert_vector_xyz
+template <bool IsCar>
+void convert_morph_target(const rw::MorphTarget& morph_target, int32_t num_vertices, gta_to_ue::Geometry& geometry)
 {
-    return mesh_data.materials.get_material_id_with_hash(get_hash_for_material(material));
+    geometry.vertices.resize(num_vertices);
+    gta_to_ue::kernels::convert_vectors<IsCar, IsCar>(morph_target.vertices, num_vertices, 100.f, geometry.vertices);
+
+    geometry.normals.resize(num_vertices);
+    if (morph_target.normals) {
+        gta_to_ue::kernels::convert_vectors<IsCar, false>(morph_target.normals, num_vertices, 1.f, geometry.normals);
+    } else {
+        std::fill(geometry.normals.z.begin(), geometry.normals.z.end(), 1.f);
+    }
 }
 
-void parse_rw_materials(const rw::Geometry* geometry, gta_to_ue::Mesh& mesh_data, const std::string& filename)
+// expands the tristrips or trilists of the geometry into a triangle list and drops degenerate triangles on the way,
+// the output buffers must have room for every triangle, returns the number of written triangles
+template <typename Index>
+size_t decode_triangles(const rw::Geometry* geometry, const MaterialIdTable& material_ids, Index* indices, int32_t* triangle_material_ids)
 {
-    for (int32_t i = 0; i < geometry->matList.numMaterials; i++)
-    {
-        std::string material_name;
-        const int32_t index = mesh_data.materials.size();
-        gta_to_ue::Color color(
-            geometry->matList.materials[i]->color.red / 255.f, 
-            geometry->matList.materials[i]->color.green / 255.f, 
-            geometry->matList.materials[i]->color.blue / 255.f, 
-            geometry->matList.materials[i]->color.alpha / 255.f
-        );
+    const rw::Mesh* meshes = geometry->meshHeader->getMeshes();
+    size_t num_triangles = 0;
 
-        if (geometry->matList.materials[i]->texture) {
-            std::string diffuse_texture_name(geometry->matList.materials[i]->texture->name, 32);
-            std::string mask_texture_name(geometry->matList.materials[i]->texture->mask, 32);
-            size_t hash = std::hash<std::string>{}(diffuse_texture_name + mask_texture_name);
-            if (mesh_data.materials.has_material_with_hash(hash)) {
-                return;
+    auto emit_triangle = [&](uint32_t vertex1, uint32_t vertex2, uint32_t vertex3, int32_t material_id) {
+        if (vertex1 == vertex2 || vertex2 == vertex3 || vertex1 == vertex3) {
+            return;
+        }
+        indices[num_triangles * 3] = static_cast<Index>(vertex1);
+        indices[num_triangles * 3 + 1] = static_cast<Index>(vertex2);
+        indices[num_triangles * 3 + 2] = static_cast<Index>(vertex3);
+        triangle_material_ids[num_triangles] = material_id;
+        num_triangles++;
+    };
+
+    for (int32_t i = 0; i < geometry->meshHeader->numMeshes; i++) {
+        const auto result = material_ids.find(meshes[i].material);
+        const int32_t material_id = result != material_ids.end() ? result->second : 0;
+        const uint16_t* mesh_indices = meshes[i].indices;
+
+        if (geometry->meshHeader->flags == rw::MeshHeader::TRISTRIP) {
+            for (uint32_t j = 2; j < meshes[i].numIndices; j++) {
+                if (j % 2 == 0) {
+                    emit_triangle(mesh_indices[j], mesh_indices[j - 2], mesh_indices[j - 1], material_id);
+                } else {
+                    emit_triangle(mesh_indices[j], mesh_indices[j - 1], mesh_indices[j - 2], material_id);
+                }
             }
-            std::ostringstream s;
-            s << filename << "_" << index;
-            mesh_data.materials.emplace_back(s.str(), diffuse_texture_name, mask_texture_name, color, hash, index);
         } else {
-            const size_t hash = std::hash<std::string>{}(color.to_string());
-            if (mesh_data.materials.has_material_with_hash(hash)) {
-                return;
+            for (uint32_t j = 0; j + 2 < meshes[i].numIndices; j += 3) {
+                emit_triangle(mesh_indices[j + 2], mesh_indices[j], mesh_indices[j + 1], material_id);
             }
-            std::ostringstream s;
-            s << filename << "_" << index;
-            mesh_data.materials.emplace_back(s.str(), "", "", color, hash, index);
         }
     }
+
+    return num_triangles;
 }
 
 void parse_rw_geometry(const rw::Geometry* geometry, int32_t frame_id, gta_to_ue::Mesh& mesh_data, const ConvertingOptions& converting_options, const std::string& filename)
 {
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::parse_geometry);
     auto& mesh_geometry_data = mesh_data.geometries.emplace_back(
         geometry->meshHeader->totalIndices / 3,
         geometry->numTexCoordSets,
@@ -191,43 +265,39 @@ void parse_rw_geometry(const rw::Geometry* geometry, int32_t frame_id, gta_to_ue
     );
     const rw::Mesh* meshes = geometry->meshHeader->getMeshes();
 
-    parse_rw_materials(geometry, mesh_data, filename);
+    const MaterialIdTable material_ids = parse_rw_materials(geometry, mesh_data, filename);
 
     if (!converting_options.is_car) {
         parse_rw_skin_data(geometry, mesh_data.geometries.size() - 1, mesh_data);
     }
 
-    if (geometry->meshHeader->flags == rw::MeshHeader::TRISTRIP) {
-        for (int32_t i = 0; i < geometry->meshHeader->numMeshes; i++) {
-            for (int32_t j = 0; j < meshes[i].numIndices; j++) {
-                if (j > 2 && j % 2 == 0 || j == 2)
-                    mesh_geometry_data.triangles.emplace_back(meshes[i].indices[j], meshes[i].indices[j - 2], meshes[i].indices[j - 1], get_material_id(meshes[i].material, mesh_data));
-                if (j > 2 && j % 2 != 0)
-                    mesh_geometry_data.triangles.emplace_back(meshes[i].indices[j], meshes[i].indices[j - 1], meshes[i].indices[j - 2], get_material_id(meshes[i].material, mesh_data));
-            }
-        }
-    } else {
-        for (int32_t i = 0; i < geometry->meshHeader->numMeshes; i++) {
-            for (int32_t j = 0; j < meshes[i].numIndices; j += 3) {
-                mesh_geometry_data.triangles.emplace_back(meshes[i].indices[j + 2], meshes[i].indices[j], meshes[i].indices[j + 1], get_material_id(meshes[i].material, mesh_data));
-            }
+    size_t max_num_triangles = 0;
+    for (int32_t i = 0; i < geometry->meshHeader->numMeshes; i++) {
+        if (geometry->meshHeader->flags == rw::MeshHeader::TRISTRIP) {
+            max_num_triangles += meshes[i].numIndices > 2 ? meshes[i].numIndices - 2 : 0;
+        } else {
+            max_num_triangles += meshes[i].numIndices / 3;
         }
     }
 
-    std::vector<gta_to_ue::Triangle> NewTriangles;
-    for (auto& triangle : mesh_geometry_data.triangles) {
-        if (triangle.vertex1 == triangle.vertex2 || triangle.vertex2 == triangle.vertex3 || triangle.vertex1 == triangle.vertex3)
-            continue;
-        NewTriangles.push_back(triangle);
-    }
-    mesh_geometry_data.triangles = std::move(NewTriangles);
+    mesh_geometry_data.indices.resize(max_num_triangles * 3);
+    mesh_geometry_data.material_ids.resize(max_num_triangles);
+
+    const size_t num_triangles = mesh_geometry_data.indices.is_wide()
+        ? decode_triangles(geometry, material_ids, mesh_geometry_data.indices.wide_data(), mesh_geometry_data.material_ids.data())
+        : decode_triangles(geometry, material_ids, mesh_geometry_data.indices.narrow_data(), mesh_geometry_data.material_ids.data());
+
+    mesh_geometry_data.indices.resize(num_triangles * 3);
+    mesh_geometry_data.material_ids.resize(num_triangles);
+
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::geometries, 1);
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::vertices, geometry->numVertices);
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::triangles, num_triangles);
 
     for (int32_t i = 0; i < geometry->numTexCoordSets; i++) {
         auto& tex_coords = mesh_geometry_data.tex_coordinate_sets.emplace_back();
-        tex_coords.reserve(geometry->numVertices);
-        for (int32_t j = 0; j < geometry->numVertices; j++) {
-            tex_coords.emplace_back(geometry->texCoords[i][j].u, geometry->texCoords[i][j].v);
-        }
+        tex_coords.resize(geometry->numVertices);
+        gta_to_ue::kernels::convert_tex_coordinates(geometry->texCoords[i], geometry->numVertices, tex_coords);
     }
 
     if (geometry->numMorphTargets == 0) {
@@ -235,47 +305,141 @@ void parse_rw_geometry(const rw::Geometry* geometry, int32_t frame_id, gta_to_ue
         return;
     }
 
-    if (geometry->numMorphTargets > 1) {
-        //todo: warning
+    const rw::MorphTarget& morph_target = geometry->morphTargets[0];
+    if (converting_options.is_car) {
+        convert_morph_target<true>(morph_target, geometry->numVertices, mesh_geometry_data);
+    } else {
+        convert_morph_target<false>(morph_target, geometry->numVertices, mesh_geometry_data);
     }
 
-    const rw::MorphTarget& morph_target = geometry->morphTargets[0];
-    for (int32_t j = 0; j < geometry->numVertices; j++) {
-        mesh_geometry_data.vertices.emplace_back(convert_vector_xyz(converting_options, morph_target.vertices[j].x, morph_target.vertices[j].y, morph_target.vertices[j].z, 100.f, true));
-        if (morph_target.normals) {
-            mesh_geometry_data.normals.emplace_back(convert_vector_xyz(converting_options, morph_target.normals[j].x, morph_target.normals[j].y, morph_target.normals[j].z, 1.f));
+    // the other targets are kept as deltas against the base one
+    gta_to_ue::Vector3Stream target_vertices;
+    target_vertices.resize(geometry->numVertices);
+    for (int32_t i = 1; i < geometry->numMorphTargets; i++) {
+        if (converting_options.is_car) {
+            gta_to_ue::kernels::convert_vectors<true, true>(geometry->morphTargets[i].vertices, geometry->numVertices, 100.f, target_vertices);
         } else {
-            mesh_geometry_data.normals.emplace_back(convert_vector_xyz(converting_options, 0.f, 0.f, 1.f, 1.f));
+            gta_to_ue::kernels::convert_vectors<false, false>(geometry->morphTargets[i].vertices, geometry->numVertices, 100.f, target_vertices);
         }
+        mesh_geometry_data.morph_targets.push_back(gta_to_ue::morph::build(mesh_geometry_data.vertices, target_vertices, converting_options.morph_threshold));
     }
 }
 
-rw::Clump* read_clump(const std::string& dff_file_name)
+rw::Clump* read_clump(rw::Stream* dff_stream, const std::string& dff_file_name)
 {
-    rw::StreamFile dff_stream_file;
-
-	if (!dff_stream_file.open(dff_file_name.c_str(), "rb")) {
-		std::cout << "file: " << dff_file_name << " is not found" << std::endl;
-		return nullptr;
-	}
-
-	if (!rw::findChunk(&dff_stream_file, rw::ID_CLUMP, nullptr, nullptr)) {
+	if (!rw::findChunk(dff_stream, rw::ID_CLUMP, nullptr, nullptr)) {
 		std::cout << "file: " << dff_file_name << " is not a clump" << std::endl;
-		dff_stream_file.close();
 		return nullptr;
 	}
 
-	rw::Clump* clump = rw::Clump::streamRead(&dff_stream_file);
+	const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::read_clump, dff_file_name);
+	rw::Clump* clump;
+	{
+		std::lock_guard lock(rw_mutex);
+		clump = rw::Clump::streamRead(dff_stream);
+	}
 	if (!clump) {
 		std::cout << "file: " << dff_file_name << " parsing error" << std::endl;
 		return nullptr;
 	}
 
+    return clump;
+}
+
+rw::Clump* read_clump(const uint8_t* data, size_t size, const std::string& dff_file_name)
+{
+    gta_to_ue::profile::add(gta_to_ue::profile::Counter::bytes_read, size);
+
+    rw::StreamMemory dff_stream_memory;
+
+    // librw only reads from the stream, the data stays untouched
+    dff_stream_memory.open(const_cast<uint8_t*>(data), static_cast<uint32_t>(size));
+    rw::Clump* clump = read_clump(&dff_stream_memory, dff_file_name);
+    dff_stream_memory.close();
+
+    return clump;
+}
+
+rw::Clump* read_clump(const std::string& dff_file_name)
+{
+    // regular files are parsed straight from the page cache, everything else goes through stdio
+    gta_to_ue::MappedFile mapped_file;
+    if (mapped_file.open(dff_file_name) && mapped_file.size() > 0 && mapped_file.size() <= UINT32_MAX) {
+        return read_clump(mapped_file.data(), mapped_file.size(), dff_file_name);
+    }
+
+    rw::StreamFile dff_stream_file;
+
+	if (!dff_stream_file.open(dff_file_name.c_str(), "rb")) {
+		std::cout << "file: " << dff_file_name << " is not found" << std::endl;
+		return nullptr;
+	}
+
+	rw::Clump* clump = read_clump(&dff_stream_file, dff_file_name);
 	dff_stream_file.close();
 
     return clump;
 }
 
+// every atomic is parsed into a mesh of its own with a local material list, merge_atomic_mesh then adds
+// the materials in atomic order the way parse_rw_materials does, so the output matches the serial parse
+void merge_atomic_mesh(gta_to_ue::Mesh& atomic_mesh, gta_to_ue::Mesh& mesh_data, const std::string& filename)
+{
+    std::vector<int32_t> material_ids(atomic_mesh.materials.size());
+    for (size_t i = 0; i < atomic_mesh.materials.size(); i++) {
+        gta_to_ue::Material material = atomic_mesh.materials[i];
+        if (mesh_data.materials.has_material_with_hash(material.hash)) {
+            material_ids[i] = mesh_data.materials.get_material_id_with_hash(material.hash);
+            continue;
+        }
+
+        std::ostringstream s;
+        material.index = mesh_data.materials.size();
+        s << filename << "_" << material.index;
+        material.material_name = s.str();
+        material_ids[i] = mesh_data.materials.add_material(std::move(material));
+    }
+
+    for (auto& geometry : atomic_mesh.geometries) {
+        for (auto& material_id : geometry.material_ids) {
+            material_id = material_id < static_cast<int32_t>(material_ids.size()) ? material_ids[material_id] : 0;
+        }
+        mesh_data.geometries.push_back(std::move(geometry));
+    }
+
+    if (atomic_mesh.has_skeleton) {
+        mesh_data.has_skeleton = true;
+        mesh_data.same_skeleton = false;
+    }
+}
+
+void parse_atomics_parallel(const std::vector<const rw::Atomic*>& atomics, const rw::FrameList_& frame_list, const ConvertingOptions& converting_options,
+    gta_to_ue::Mesh& mesh_data, const std::string& filename, int32_t num_workers)
+{
+    // librw allocates in correctTristripWinding and generateTriangles, only the reads of the geometries run in parallel
+    for (const rw::Atomic* atomic : atomics) {
+        atomic->geometry->correctTristripWinding();
+        atomic->geometry->generateTriangles();
+    }
+
+    std::vector<gta_to_ue::Mesh> atomic_meshes(atomics.size());
+    {
+        gta_to_ue::WorkerPool pool(num_workers);
+        for (size_t i = 0; i < atomics.size(); i++) {
+            pool.submit([&, i] {
+                const rw::Atomic* atomic = atomics[i];
+                parse_rw_geometry(atomic->geometry, rw::findPointer(atomic->getFrame(), reinterpret_cast<void**>(frame_list.frames), frame_list.numFrames), atomic_meshes[i], converting_options, filename);
+            });
+        }
+        pool.wait();
+    }
+
+    mesh_data.geometries.reserve(mesh_data.geometries.size() + atomics.size());
+    for (auto& atomic_mesh : atomic_meshes) {
+        merge_atomic_mesh(atomic_mesh, mesh_data, filename);
+    }
+}
+
 void parse_dff(rw::Clump* clump, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data, const std::string& filename)
 {
 	//frames data
@@ -289,17 +453,29 @@ void parse_dff(rw::Clump* clump, const ConvertingOptions& converting_options, gt
 	parse_rw_frames(frame_list, converting_options, mesh_data);
 
 	//atomics
+	std::vector<const rw::Atomic*> atomics;
+	int32_t num_vertices = 0;
 	FORLIST(lnk, clump->atomics)
 	{
 		const rw::Atomic* atomic = rw::Atomic::fromClump(lnk);
-		atomic->geometry->correctTristripWinding();
-		atomic->geometry->generateTriangles();
-		parse_rw_geometry(atomic->geometry, rw::findPointer(atomic->getFrame(), reinterpret_cast<void**>(frame_list.frames), frame_list.numFrames), mesh_data, converting_options, filename);
+		atomics.push_back(atomic);
+		num_vertices += atomic->geometry->numVertices;
+	}
+
+	const int32_t num_workers = std::min(num_atomic_workers.load(std::memory_order_relaxed), static_cast<int32_t>(atomics.size()));
+	if (num_workers < 2 || num_vertices < min_parallel_vertices) {
+		for (const rw::Atomic* atomic : atomics) {
+			atomic->geometry->correctTristripWinding();
+			atomic->geometry->generateTriangles();
+			parse_rw_geometry(atomic->geometry, rw::findPointer(atomic->getFrame(), reinterpret_cast<void**>(frame_list.frames), frame_list.numFrames), mesh_data, converting_options, filename);
+		}
+	} else {
+		parse_atomics_parallel(atomics, frame_list, converting_options, mesh_data, filename, num_workers);
 	}
 	rwFree(frame_list.frames);
 }
 
-rw::Clump* gta_to_ue::dff::parse(const std::string& dff_file_name, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data)
+std::string get_model_name(const std::string& dff_file_name)
 {
     const std::filesystem::path path = std::filesystem::path(dff_file_name);
     const std::string ext = path.has_extension() ? path.extension().string() : "";
@@ -308,26 +484,107 @@ rw::Clump* gta_to_ue::dff::parse(const std::string& dff_file_name, const Convert
         filename = filename.substr(0, filename.length() - ext.length());
     }
 
-    rw::Clump* clump = read_clump(dff_file_name);
-    if (!clump) {
+    return filename;
+}
+
+struct CachedWheelMesh
+{
+    std::filesystem::file_time_type write_time;
+    std::shared_ptr<const gta_to_ue::WheelMesh> wheel_mesh;
+};
+
+// the wheels dff is shared by every car of a run, it's parsed once per path and parse options and reparsed when the file changes
+std::mutex wheel_mesh_cache_mutex;
+std::unordered_map<std::string, CachedWheelMesh> wheel_mesh_cache;
+
+// the path and every option parse_dff reads, serve requests with other options must not get a mesh parsed with the first ones
+std::string get_wheel_mesh_key(const ConvertingOptions& converting_options)
+{
+    std::ostringstream s;
+    s << converting_options.is_car << ' ' << std::hexfloat << converting_options.morph_threshold << ' ' << converting_options.wheels_dff;
+    return s.str();
+}
+
+std::shared_ptr<const gta_to_ue::WheelMesh> get_wheel_mesh(const ConvertingOptions& converting_options)
+{
+    std::error_code error;
+    const auto write_time = std::filesystem::last_write_time(converting_options.wheels_dff, error);
+    if (error) {
+        std::cout << "file: " << converting_options.wheels_dff << " is not found" << std::endl;
         return nullptr;
     }
 
-    parse_dff(clump, converting_options, mesh_data, filename);
+    const std::string key = get_wheel_mesh_key(converting_options);
+    std::lock_guard lock(wheel_mesh_cache_mutex);
+    if (const auto result = wheel_mesh_cache.find(key); result != wheel_mesh_cache.end() && result->second.write_time == write_time) {
+        return result->second.wheel_mesh;
+    }
+
+    rw::Clump* wheels_clump = read_clump(converting_options.wheels_dff);
+    if (!wheels_clump) {
+        return nullptr;
+    }
 
-    rw::Clump* wheels_clump;
     gta_to_ue::Mesh wheels_mesh_data;
+    parse_dff(wheels_clump, converting_options, wheels_mesh_data, "wheels");
+    gta_to_ue::dff::destroy(wheels_clump);
+
+    auto wheel_mesh = std::make_shared<const gta_to_ue::WheelMesh>(std::move(wheels_mesh_data));
+    wheel_mesh_cache[key] = CachedWheelMesh{ write_time, wheel_mesh };
+    return wheel_mesh;
+}
+
+void parse_model(rw::Clump* clump, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data, const std::string& filename)
+{
+    parse_dff(clump, converting_options, mesh_data, filename);
+    gta_to_ue::lod::assign_lod_levels(mesh_data);
+
     if (converting_options.is_car) {
         if (converting_options.wheels_dff != "") {
-            wheels_clump = read_clump(converting_options.wheels_dff);
-            if (wheels_clump) {
-				parse_dff(wheels_clump, converting_options, wheels_mesh_data, "wheels");
-                gta_to_ue::mixin_car_wheel(converting_options, mesh_data, wheels_mesh_data);
+            if (const auto wheel_mesh = get_wheel_mesh(converting_options)) {
+                const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::car_wheels);
+                gta_to_ue::mixin_car_wheel(converting_options, mesh_data, *wheel_mesh);
             }
         }
 
+        const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::build_car);
         gta_to_ue::build_car(mesh_data);
-    }  
+    }
+
+    gta_to_ue::skin::compact_skeletons(mesh_data);
+}
+
+rw::Clump* gta_to_ue::dff::parse(const std::string& dff_file_name, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data)
+{
+    rw::Clump* clump = read_clump(dff_file_name);
+    if (!clump) {
+        return nullptr;
+    }
+
+    parse_model(clump, converting_options, mesh_data, get_model_name(dff_file_name));
+
+    return clump;
+}
+
+rw::Clump* gta_to_ue::dff::parse(const uint8_t* data, size_t size, const std::string& dff_file_name, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data)
+{
+    rw::Clump* clump = read_clump(data, size, dff_file_name);
+    if (!clump) {
+        return nullptr;
+    }
+
+    parse_model(clump, converting_options, mesh_data, get_model_name(dff_file_name));
 
     return clump;
+}
+
+void gta_to_ue::dff::set_num_atomic_workers(int32_t num_workers)
+{
+    num_atomic_workers = std::max(num_workers, 1);
+}
+
+void gta_to_ue::dff::destroy(rw::Clump* clump)
+{
+    std::lock_guard lock(rw_mutex);
+    clump->destroy();
 }
\ No newline at end of file
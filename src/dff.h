@@ -1,10 +1,27 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include "common.h"
 
 namespace gta_to_ue {
     namespace dff {
         rw::Clump* parse(const std::string& dff_file_name, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data);
+        // parses a dff held in memory, dff_file_name is only used for naming and messages
+        rw::Clump* parse(const uint8_t* data, size_t size, const std::string& dff_file_name, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data);
+        void destroy(rw::Clump* clump);
+
+        // the atomics of a big clump are parsed on up to num_workers threads, the output is the same for any count.
+        // the default of 1 parses them on the calling thread, batch and serve modes already convert a file per worker
+        void set_num_atomic_workers(int32_t num_workers);
     }
 }
+
+// the stages of dff::parse, exposed for the benchmarks. parse_rw_geometry expects the triangles of the geometry
+// to be generated (correctTristripWinding and generateTriangles), parse_rw_skin_data fills an already parsed geometry
+using MaterialIdTable = std::unordered_map<const rw::Material*, int32_t>;
+
+void parse_rw_frames(const rw::FrameList_& frame_list, const ConvertingOptions& converting_options, gta_to_ue::Mesh& mesh_data);
+MaterialIdTable parse_rw_materials(const rw::Geometry* geometry, gta_to_ue::Mesh& mesh_data, const std::string& filename);
+void parse_rw_geometry(const rw::Geometry* geometry, int32_t frame_id, gta_to_ue::Mesh& mesh_data, const ConvertingOptions& converting_options, const std::string& filename);
+void parse_rw_skin_data(const rw::Geometry* geometry, int32_t geometry_id, gta_to_ue::Mesh& mesh_data);
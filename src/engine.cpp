@@ -0,0 +1,25 @@
+#include "engine.h"
+#include "common.h"
+
+bool gta_to_ue::init_rw()
+{
+    rw::platform = rw::PLATFORM_GL3;
+    if (!rw::Engine::init()) {
+        return false;
+    }
+
+    gta::attachPlugins();
+
+    if (!rw::Engine::open(nil)) {
+        return false;
+    }
+
+    if (!rw::Engine::start()) {
+        return false;
+    }
+
+    rw::Texture::setLoadTextures(false);
+    rw::Texture::setCreateDummies(true);
+
+    return true;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace gta_to_ue {
+    // initializes the rw engine and the gta plugins once per process, texture loading is off
+    bool init_rw();
+}
@@ -0,0 +1,92 @@
+#include "hash.h"
+
+#include <bit>
+#include <cstring>
+
+constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t prime64_3 = 0x165667B19E3779F9ull;
+constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ull;
+
+static_assert(std::endian::native == std::endian::little, "xxh64 reads the input as little-endian words");
+
+uint64_t read_u64(const uint8_t* p)
+{
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t read_u32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint64_t round64(uint64_t acc, uint64_t input)
+{
+    acc += input * prime64_2;
+    acc = std::rotl(acc, 31);
+    return acc * prime64_1;
+}
+
+uint64_t merge_round64(uint64_t acc, uint64_t value)
+{
+    acc ^= round64(0, value);
+    return acc * prime64_1 + prime64_4;
+}
+
+uint64_t gta_to_ue::hash::xxh64(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    const uint8_t* const end = p + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + prime64_1 + prime64_2;
+        uint64_t v2 = seed + prime64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - prime64_1;
+        const uint8_t* const limit = end - 32;
+        do {
+            v1 = round64(v1, read_u64(p));
+            v2 = round64(v2, read_u64(p + 8));
+            v3 = round64(v3, read_u64(p + 16));
+            v4 = round64(v4, read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        hash = merge_round64(hash, v1);
+        hash = merge_round64(hash, v2);
+        hash = merge_round64(hash, v3);
+        hash = merge_round64(hash, v4);
+    } else {
+        hash = seed + prime64_5;
+    }
+
+    hash += size;
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= round64(0, read_u64(p));
+        hash = std::rotl(hash, 27) * prime64_1 + prime64_4;
+    }
+    if (p + 4 <= end) {
+        hash ^= read_u32(p) * prime64_1;
+        hash = std::rotl(hash, 23) * prime64_2 + prime64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash ^= *p * prime64_5;
+        hash = std::rotl(hash, 11) * prime64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime64_2;
+    hash ^= hash >> 29;
+    hash *= prime64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gta_to_ue {
+    namespace hash {
+        // 64-bit xxHash (XXH64) of the bytes
+        uint64_t xxh64(const void* data, size_t size, uint64_t seed = 0);
+    }
+}
@@ -0,0 +1,113 @@
+#include "img.h"
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+constexpr size_t sector_size = 2048;
+constexpr size_t dir_entry_size = 32;
+constexpr size_t dir_entry_name_size = 24;
+
+uint32_t read_u32(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+bool gta_to_ue::img::Archive::open(const std::string& img_file_name)
+{
+    entries.clear();
+
+    if (!img_file.open(img_file_name)) {
+        std::cout << "file: " << img_file_name << " is not found" << std::endl;
+        return false;
+    }
+
+    if (img_file.size() >= 8 && std::memcmp(img_file.data(), "VER2", 4) == 0) {
+        const size_t num_entries = read_u32(img_file.data() + 4);
+        if (8 + num_entries * dir_entry_size > img_file.size()) {
+            std::cout << "file: " << img_file_name << " has a broken directory" << std::endl;
+            return false;
+        }
+        return read_entries(img_file.data() + 8, num_entries, true);
+    }
+
+    std::filesystem::path dir_file_name(img_file_name);
+    dir_file_name.replace_extension(".dir");
+
+    MappedFile dir_file;
+    if (!dir_file.open(dir_file_name.string())) {
+        std::cout << "file: " << dir_file_name.string() << " is not found" << std::endl;
+        return false;
+    }
+
+    return read_entries(dir_file.data(), dir_file.size() / dir_entry_size, false);
+}
+
+bool gta_to_ue::img::Archive::read_entries(const uint8_t* data, size_t num_entries, bool is_v2)
+{
+    entries.reserve(num_entries);
+    for (size_t i = 0; i < num_entries; i++) {
+        const uint8_t* dir_entry = data + i * dir_entry_size;
+        const size_t offset = static_cast<size_t>(read_u32(dir_entry)) * sector_size;
+        size_t size = static_cast<size_t>(read_u32(dir_entry + 4));
+        if (is_v2) {
+            // uint16 streaming size followed by uint16 archive size, which is usually zero
+            size = (size & 0xFFFF) != 0 ? (size & 0xFFFF) : (size >> 16);
+        }
+        size *= sector_size;
+        const char* name = reinterpret_cast<const char*>(dir_entry + 8);
+
+        Entry entry{ std::string(name, strnlen(name, dir_entry_name_size)), offset, size };
+        if (entry.offset + entry.size > img_file.size()) {
+            // the last entry may be shorter than its sector count
+            if (entry.offset >= img_file.size()) {
+                std::cout << "entry: " << entry.name << " is out of the archive" << std::endl;
+                continue;
+            }
+            entry.size = img_file.size() - entry.offset;
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+const std::vector<gta_to_ue::img::Entry>& gta_to_ue::img::Archive::get_entries() const
+{
+    return entries;
+}
+
+const uint8_t* gta_to_ue::img::Archive::get_data(const Entry& entry) const
+{
+    return img_file.data() + entry.offset;
+}
+
+bool gta_to_ue::img::match_name(const std::string& pattern, const std::string& name)
+{
+    size_t p = 0;
+    size_t n = 0;
+    size_t star = std::string::npos;
+    size_t star_n = 0;
+
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || std::tolower(static_cast<unsigned char>(pattern[p])) == std::tolower(static_cast<unsigned char>(name[n])))) {
+            p++;
+            n++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_n = n;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            n = ++star_n;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+
+    return p == pattern.size();
+}
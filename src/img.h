@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+namespace gta_to_ue {
+    namespace img {
+        struct Entry
+        {
+            std::string name;
+            size_t offset;
+            size_t size;
+        };
+
+        // gta3/vc archives (v1, entries in a .dir file next to the .img) and sa archives (v2, "VER2" header inside the .img)
+        class Archive
+        {
+        public:
+            bool open(const std::string& img_file_name);
+
+            const std::vector<Entry>& get_entries() const;
+            const uint8_t* get_data(const Entry& entry) const;
+
+        private:
+            bool read_entries(const uint8_t* data, size_t num_entries, bool is_v2);
+
+            MappedFile img_file;
+            std::vector<Entry> entries;
+        };
+
+        // case-insensitive glob match supporting '*' and '?'
+        bool match_name(const std::string& pattern, const std::string& name);
+    }
+}
@@ -1,20 +1,37 @@
 #include "json.h"
-#include <fstream>
+#include "lod.h"
+#include "output_stream.h"
+#include "skin.h"
+#include "worker_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
 #include <rapidjson/writer.h>
 
-using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+using JsonWriter = rapidjson::Writer<gta_to_ue::OutputStream>;
 
-void export_object_info(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
+// smaller meshes aren't worth starting the workers for
+constexpr size_t min_parallel_vertices = 8192;
+std::atomic<int32_t> num_export_workers{ 1 };
+
+void export_object_info(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options)
 {
     writer.Key("Info");
     writer.StartObject();
     writer.Key("Version");
-    writer.Int(1);
+    writer.Int(gta_to_ue::json::version);
+    writer.Key("Layout");
+    writer.String(export_options.json_layout == JsonLayout::compact ? "compact" : "objects");
     writer.Key("HasSkeleton");
     writer.Bool(mesh_data.has_skeleton);
 	writer.Key("SameSkeleton");
 	writer.Bool(mesh_data.same_skeleton);
+    writer.Key("NumLODs");
+    writer.Int(gta_to_ue::lod::get_num_lod_levels(mesh_data));
+    writer.Key("HasInstances");
+    writer.Bool(!mesh_data.instances.empty());
     writer.EndObject();
 }
 
@@ -37,7 +54,6 @@ void export_object_anim_hierarchies(JsonWriter& writer, const gta_to_ue::Mesh& m
 
 void export_object_frames(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
 {
-    writer.Key("Frames");
     writer.StartArray();
     for (auto& frame : mesh_data.frames) {
         writer.StartObject();
@@ -91,7 +107,6 @@ void export_object_frames(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
 
 void export_object_materials(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
 {
-    writer.Key("Materials");
     writer.StartArray();
     for (auto& material : mesh_data.materials) {
         writer.StartObject();
@@ -123,17 +138,17 @@ void export_geometry_triangles(JsonWriter& writer, const gta_to_ue::Geometry& ge
 {
     writer.Key("Triangles");
     writer.StartArray();
-    for (auto& triangle : geometry.triangles) 
+    for (size_t i = 0; i < geometry.get_num_triangles(); i++) 
     {
         writer.StartObject();
         writer.Key("A");
-        writer.Int(triangle.vertex1);
+        writer.Uint(geometry.indices[i * 3]);
         writer.Key("B");
-        writer.Int(triangle.vertex2);
+        writer.Uint(geometry.indices[i * 3 + 1]);
         writer.Key("C");
-        writer.Int(triangle.vertex3);
+        writer.Uint(geometry.indices[i * 3 + 2]);
         writer.Key("MaterialID");
-        writer.Int(triangle.material_id);
+        writer.Int(geometry.material_ids[i]);
         writer.EndObject();
     }
     writer.EndArray();
@@ -146,13 +161,13 @@ void export_geometry_tex_coordinate_sets(JsonWriter& writer, const gta_to_ue::Ge
     for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) 
     {
         //writer.StartArray(); ue4 doesn't support nested tarray
-        for (auto& tex_coordinate : tex_coordinate_set) 
+        for (size_t i = 0; i < tex_coordinate_set.size(); i++) 
         {
             writer.StartObject();
             writer.Key("U");
-            writer.Double(tex_coordinate.x);
+            writer.Double(tex_coordinate_set.x[i]);
             writer.Key("V");
-            writer.Double(tex_coordinate.y);
+            writer.Double(tex_coordinate_set.y[i]);
             writer.EndObject();
         }
         //writer.EndArray();
@@ -164,45 +179,50 @@ void export_geometry_vertex_data(JsonWriter& writer, const gta_to_ue::Geometry&
 {
     writer.Key("Vertices");
     writer.StartArray();
-    for (auto& vertex : geometry.vertices) {
+    for (size_t i = 0; i < geometry.vertices.size(); i++) {
         writer.StartObject();
         writer.Key("X");
-        writer.Double(vertex.x);
+        writer.Double(geometry.vertices.x[i]);
         writer.Key("Y");
-        writer.Double(vertex.y);
+        writer.Double(geometry.vertices.y[i]);
         writer.Key("Z");
-        writer.Double(vertex.z);
+        writer.Double(geometry.vertices.z[i]);
         writer.EndObject();
     }
     writer.EndArray();
 
     writer.Key("Normals");
     writer.StartArray();
-    for (auto& normal : geometry.normals) {
+    for (size_t i = 0; i < geometry.normals.size(); i++) {
         writer.StartObject();
         writer.Key("X");
-        writer.Double(normal.x);
+        writer.Double(geometry.normals.x[i]);
         writer.Key("Y");
-        writer.Double(normal.y);
+        writer.Double(geometry.normals.y[i]);
         writer.Key("Z");
-        writer.Double(normal.z);
+        writer.Double(geometry.normals.z[i]);
         writer.EndObject();
     }
     writer.EndArray();
 }
 
-void export_geometry_skeleton(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
+// the legacy layout expands the shared skeleton and the rigid bindings back into every geometry
+void export_geometry_skeleton(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data, const gta_to_ue::Geometry& geometry)
 {
+    const gta_to_ue::Skeleton& bind_skeleton = gta_to_ue::skin::get_bind_skeleton(mesh_data, geometry);
+    const size_t num_skin_vertices = geometry.skeleton.rigid_bone_id != -1 ? geometry.vertices.size() : geometry.skeleton.weights.size();
+
     writer.Key("Skeleton");
     writer.StartObject();
     writer.Key("NumBones");
-    writer.Int(geometry.skeleton.num_bones);
+    writer.Int(bind_skeleton.num_bones);
     writer.Key("NumUsedBones");
-    writer.Int(geometry.skeleton.num_used_bones);
+    writer.Int(bind_skeleton.num_used_bones);
 
     writer.Key("Weights");
     writer.StartArray();
-    for (auto& weight : geometry.skeleton.weights) {
+    for (size_t i = 0; i < num_skin_vertices; i++) {
+        const gta_to_ue::VertexWeight weight = gta_to_ue::skin::get_weight(geometry, i);
         writer.StartObject();
         writer.Key("WeightOne");
         writer.Double(weight.weight1);
@@ -218,30 +238,31 @@ void export_geometry_skeleton(JsonWriter& writer, const gta_to_ue::Geometry& geo
 
     writer.Key("Indices");
     writer.StartArray();
-    for (auto& index : geometry.skeleton.bone_indices) {
+    for (size_t i = 0; i < num_skin_vertices; i++) {
+        const gta_to_ue::BoneIndex index = gta_to_ue::skin::get_bone_index(geometry, i);
         writer.StartObject();
         writer.Key("BoneOne");
-        writer.Double(index.bone1);
+        writer.Int(index.bone1);
         writer.Key("BoneTwo");
-        writer.Double(index.bone2);
+        writer.Int(index.bone2);
         writer.Key("BoneThree");
-        writer.Double(index.bone3);
+        writer.Int(index.bone3);
         writer.Key("BoneFour");
-        writer.Double(index.bone4);
+        writer.Int(index.bone4);
         writer.EndObject();
     }
     writer.EndArray();
 
     writer.Key("Ids");
     writer.StartArray();
-    for (auto& id : geometry.skeleton.bone_ids) {
+    for (auto& id : bind_skeleton.bone_ids) {
         writer.Int(id);
     }
     writer.EndArray();
 
     writer.Key("Transform");
     writer.StartArray();
-    for (auto& transform : geometry.skeleton.inverse_matrices) {
+    for (auto& transform : bind_skeleton.inverse_matrices) {
         writer.StartObject();
         writer.Key("AxisX");
         writer.StartObject();
@@ -286,52 +307,373 @@ void export_geometry_skeleton(JsonWriter& writer, const gta_to_ue::Geometry& geo
     writer.EndObject();
 }
 
-void export_geometries(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
+void export_geometry_triangles_compact(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
 {
-    writer.Key("Geometries");
+    writer.Key("Indices");
     writer.StartArray();
-    for (auto& geometry : mesh_data.geometries) 
-    {
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        writer.Uint(geometry.indices[i]);
+    }
+    writer.EndArray();
+
+    writer.Key("MaterialIDs");
+    writer.StartArray();
+    for (auto& material_id : geometry.material_ids) {
+        writer.Int(material_id);
+    }
+    writer.EndArray();
+}
+
+void export_geometry_tex_coordinate_sets_compact(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
+{
+    writer.Key("NumTextureCoordinateSets");
+    writer.Int(geometry.tex_coordinate_sets.size());
+    writer.Key("TextureCoordinates");
+    writer.StartArray();
+    for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+        for (size_t i = 0; i < tex_coordinate_set.size(); i++) {
+            writer.Double(tex_coordinate_set.x[i]);
+            writer.Double(tex_coordinate_set.y[i]);
+        }
+    }
+    writer.EndArray();
+}
+
+void export_geometry_vertex_data_compact(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
+{
+    writer.Key("Vertices");
+    writer.StartArray();
+    for (size_t i = 0; i < geometry.vertices.size(); i++) {
+        writer.Double(geometry.vertices.x[i]);
+        writer.Double(geometry.vertices.y[i]);
+        writer.Double(geometry.vertices.z[i]);
+    }
+    writer.EndArray();
+
+    writer.Key("Normals");
+    writer.StartArray();
+    for (size_t i = 0; i < geometry.normals.size(); i++) {
+        writer.Double(geometry.normals.x[i]);
+        writer.Double(geometry.normals.y[i]);
+        writer.Double(geometry.normals.z[i]);
+    }
+    writer.EndArray();
+}
+
+// NumBones, NumUsedBones, Ids and the AxisX, AxisY, AxisZ, Position of every bone
+void export_skeleton_bones_compact(JsonWriter& writer, const gta_to_ue::Skeleton& skeleton)
+{
+    writer.Key("NumBones");
+    writer.Int(skeleton.num_bones);
+    writer.Key("NumUsedBones");
+    writer.Int(skeleton.num_used_bones);
+
+    writer.Key("Ids");
+    writer.StartArray();
+    for (auto& id : skeleton.bone_ids) {
+        writer.Int(id);
+    }
+    writer.EndArray();
+
+    writer.Key("Transform");
+    writer.StartArray();
+    for (auto& transform : skeleton.inverse_matrices) {
+        for (const auto* vector : { &transform.x_axis, &transform.y_axis, &transform.z_axis, &transform.pos }) {
+            writer.Double(vector->x);
+            writer.Double(vector->y);
+            writer.Double(vector->z);
+        }
+    }
+    writer.EndArray();
+}
+
+// the bones of a skeleton shared by the geometries, written once at the root
+void export_object_skeleton_compact(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
+{
+    if (!mesh_data.same_skeleton) {
+        return;
+    }
+
+    writer.Key("Skeleton");
+    writer.StartObject();
+    export_skeleton_bones_compact(writer, mesh_data.skeleton);
+    writer.EndObject();
+}
+
+// NumInfluences bone indices and weights (0-255, 255 in total) per vertex, or just the RigidBoneID of a geometry bound to a single bone.
+// the bones follow only when the skeleton isn't shared through the root one
+void export_geometry_skeleton_compact(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data, const gta_to_ue::Geometry& geometry)
+{
+    const gta_to_ue::skin::CompactSkin compact_skin = gta_to_ue::skin::compact(geometry);
+
+    writer.Key("Skeleton");
+    writer.StartObject();
+    writer.Key("RigidBoneID");
+    writer.Int(geometry.skeleton.rigid_bone_id);
+    writer.Key("NumInfluences");
+    writer.Int(compact_skin.num_influences);
+
+    writer.Key("Indices");
+    writer.StartArray();
+    for (const uint8_t index : compact_skin.bone_indices) {
+        writer.Uint(index);
+    }
+    writer.EndArray();
+
+    writer.Key("Weights");
+    writer.StartArray();
+    for (const uint8_t weight : compact_skin.weights) {
+        writer.Uint(weight);
+    }
+    writer.EndArray();
+
+    if (!mesh_data.same_skeleton) {
+        export_skeleton_bones_compact(writer, geometry.skeleton);
+    }
+
+    writer.EndObject();
+}
+
+void export_vector(JsonWriter& writer, const gta_to_ue::Vector3f& vector)
+{
+    writer.StartObject();
+    writer.Key("X");
+    writer.Double(vector.x);
+    writer.Key("Y");
+    writer.Double(vector.y);
+    writer.Key("Z");
+    writer.Double(vector.z);
+    writer.EndObject();
+}
+
+// the deltas stay quantized, see gta_to_ue::MorphTarget for decoding them with DeltaMin and DeltaMax
+void export_geometry_morph_targets(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
+{
+    writer.Key("MorphTargets");
+    writer.StartArray();
+    for (auto& morph_target : geometry.morph_targets) {
+        writer.StartObject();
+        writer.Key("DeltaMin");
+        export_vector(writer, morph_target.delta_min);
+        writer.Key("DeltaMax");
+        export_vector(writer, morph_target.delta_max);
+        writer.Key("Deltas");
+        writer.StartArray();
+        for (size_t i = 0; i < morph_target.vertex_ids.size(); i++) {
+            writer.StartObject();
+            writer.Key("VertexID");
+            writer.Uint(morph_target.vertex_ids[i]);
+            writer.Key("X");
+            writer.Int(morph_target.deltas[i * 3]);
+            writer.Key("Y");
+            writer.Int(morph_target.deltas[i * 3 + 1]);
+            writer.Key("Z");
+            writer.Int(morph_target.deltas[i * 3 + 2]);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+void export_geometry_morph_targets_compact(JsonWriter& writer, const gta_to_ue::Geometry& geometry)
+{
+    writer.Key("MorphTargets");
+    writer.StartArray();
+    for (auto& morph_target : geometry.morph_targets) {
         writer.StartObject();
+        writer.Key("DeltaMin");
+        writer.StartArray();
+        writer.Double(morph_target.delta_min.x);
+        writer.Double(morph_target.delta_min.y);
+        writer.Double(morph_target.delta_min.z);
+        writer.EndArray();
+        writer.Key("DeltaMax");
+        writer.StartArray();
+        writer.Double(morph_target.delta_max.x);
+        writer.Double(morph_target.delta_max.y);
+        writer.Double(morph_target.delta_max.z);
+        writer.EndArray();
+        writer.Key("VertexIDs");
+        writer.StartArray();
+        for (const uint32_t vertex_id : morph_target.vertex_ids) {
+            writer.Uint(vertex_id);
+        }
+        writer.EndArray();
+        writer.Key("Deltas");
+        writer.StartArray();
+        for (const int16_t delta : morph_target.deltas) {
+            writer.Int(delta);
+        }
+        writer.EndArray();
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+void export_object_instances(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
+{
+    writer.Key("Instances");
+    writer.StartArray();
+    for (auto& instance : mesh_data.instances) {
+        writer.StartObject();
+        writer.Key("GeometryID");
+        writer.Int(instance.geometry_id);
         writer.Key("FrameID");
-        writer.Int(geometry.frame_id);
-        writer.Key("HasSkeleton");
-        writer.Bool(geometry.has_skeleton);
-        export_geometry_skeleton(writer, geometry);
+        writer.Int(instance.frame_id);
+        writer.Key("Mirror");
+        writer.Bool(instance.mirror);
+        writer.Key("Scale");
+        writer.Double(instance.scale);
+        writer.Key("BoneID");
+        writer.Int(instance.bone_id);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+void export_geometry(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data, const gta_to_ue::Geometry& geometry, const ExportOptions& export_options)
+{
+    writer.StartObject();
+    writer.Key("FrameID");
+    writer.Int(geometry.frame_id);
+    writer.Key("LODLevel");
+    writer.Int(geometry.lod_level);
+    writer.Key("HasSkeleton");
+    writer.Bool(geometry.has_skeleton);
+    writer.Key("Instanced");
+    writer.Bool(geometry.is_instanced);
+    if (export_options.json_layout == JsonLayout::compact) {
+        export_geometry_skeleton_compact(writer, mesh_data, geometry);
+        export_geometry_triangles_compact(writer, geometry);
+        export_geometry_tex_coordinate_sets_compact(writer, geometry);
+        export_geometry_vertex_data_compact(writer, geometry);
+        export_geometry_morph_targets_compact(writer, geometry);
+    } else {
+        export_geometry_skeleton(writer, mesh_data, geometry);
         export_geometry_triangles(writer, geometry);
         export_geometry_tex_coordinate_sets(writer, geometry);
         export_geometry_vertex_data(writer, geometry);
-        writer.EndObject();
+        export_geometry_morph_targets(writer, geometry);
     }
-    writer.EndArray();
+    writer.EndObject();
 }
 
-void export_object(JsonWriter& writer, const gta_to_ue::Mesh& mesh_data)
+// a json value of the object that can be written on its own: the frames, the materials or a geometry
+struct Section
+{
+    rapidjson::Type type;
+    std::function<void(JsonWriter&)> export_value;
+};
+
+// writes the sections in place, or serializes the next batch of them on the workers and copies the buffers in. a compact
+// rapidjson writer puts no whitespace between values, so the separators it adds around a buffer give the same bytes.
+// at most one batch of sections is held in memory, the rest of the file goes straight to the (possibly compressed) stream
+class SectionWriter
+{
+public:
+    SectionWriter(JsonWriter& in_writer, gta_to_ue::OutputStream& in_stream, const std::vector<Section>& in_sections, int32_t num_workers) :
+        writer(in_writer), stream(in_stream), sections(in_sections)
+    {
+        if (num_workers < 2) {
+            return;
+        }
+
+        pool = std::make_unique<gta_to_ue::WorkerPool>(num_workers);
+        buffers.resize(sections.size());
+        batch_size = static_cast<size_t>(num_workers) * 2;
+    }
+
+    void write(size_t section_id)
+    {
+        if (!pool) {
+            sections[section_id].export_value(writer);
+            return;
+        }
+
+        if (!buffers[section_id]) {
+            serialize_batch(section_id);
+        }
+
+        // an empty raw value only adds the separator, the buffer is then copied in one go
+        const std::vector<char>& data = buffers[section_id]->get_data();
+        writer.RawValue("", 0, sections[section_id].type);
+        stream.write(data.data(), data.size());
+        buffers[section_id].reset();
+    }
+
+private:
+    void serialize_batch(size_t first_section_id)
+    {
+        const size_t end_section_id = std::min(first_section_id + batch_size, sections.size());
+        for (size_t i = first_section_id; i < end_section_id; i++) {
+            buffers[i] = std::make_unique<gta_to_ue::MemoryOutputStream>();
+            pool->submit([this, i] {
+                JsonWriter section_writer(*buffers[i]);
+                sections[i].export_value(section_writer);
+            });
+        }
+        pool->wait();
+    }
+
+    JsonWriter& writer;
+    gta_to_ue::OutputStream& stream;
+    const std::vector<Section>& sections;
+    std::unique_ptr<gta_to_ue::WorkerPool> pool;
+    std::vector<std::unique_ptr<gta_to_ue::MemoryOutputStream>> buffers;
+    size_t batch_size{ 0 };
+};
+
+void export_object(JsonWriter& writer, gta_to_ue::OutputStream& stream, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options)
 {
+    std::vector<Section> sections;
+    sections.reserve(mesh_data.geometries.size() + 2);
+    sections.push_back({ rapidjson::kArrayType, [&](JsonWriter& section_writer) { export_object_frames(section_writer, mesh_data); } });
+    sections.push_back({ rapidjson::kArrayType, [&](JsonWriter& section_writer) { export_object_materials(section_writer, mesh_data); } });
+    size_t num_vertices = 0;
+    for (auto& geometry : mesh_data.geometries) {
+        sections.push_back({ rapidjson::kObjectType, [&](JsonWriter& section_writer) { export_geometry(section_writer, mesh_data, geometry, export_options); } });
+        num_vertices += geometry.vertices.size();
+    }
+
+    const int32_t num_workers = num_vertices >= min_parallel_vertices ? num_export_workers.load(std::memory_order_relaxed) : 1;
+    SectionWriter section_writer(writer, stream, sections, num_workers);
+
     writer.StartObject();
-    export_object_info(writer, mesh_data);
-    export_object_frames(writer, mesh_data);
+    export_object_info(writer, mesh_data, export_options);
+    writer.Key("Frames");
+    section_writer.write(0);
     export_object_anim_hierarchies(writer, mesh_data);
-    export_object_materials(writer, mesh_data);
-    export_geometries(writer, mesh_data);
+    if (export_options.json_layout == JsonLayout::compact) {
+        export_object_skeleton_compact(writer, mesh_data);
+    }
+    writer.Key("Materials");
+    section_writer.write(1);
+    export_object_instances(writer, mesh_data);
+    writer.Key("Geometries");
+    writer.StartArray();
+    for (size_t i = 0; i < mesh_data.geometries.size(); i++) {
+        section_writer.write(i + 2);
+    }
+    writer.EndArray();
     writer.EndObject();
 }
 
-bool gta_to_ue::json::export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data)
+void gta_to_ue::json::set_num_workers(int32_t num_workers)
 {
-    std::ofstream ofs;
-    ofs.open(file_name);
+    num_export_workers = std::max(num_workers, 1);
+}
 
-    if (!ofs.is_open()) {
+bool gta_to_ue::json::export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options)
+{
+    const std::unique_ptr<gta_to_ue::FileOutputStream> ofs = gta_to_ue::create_file_output_stream(export_options);
+    if (!ofs->open(file_name)) {
         return false;
     }
 
-    rapidjson::StringBuffer s;
-    JsonWriter writer(s);
-    export_object(writer, mesh_data);
-
-    ofs << s.GetString();
-    ofs.close();
+    JsonWriter writer(*ofs);
+    export_object(writer, *ofs, mesh_data, export_options);
 
-    return true;
+    return ofs->close();
 }
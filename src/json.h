@@ -5,6 +5,14 @@
 
 namespace gta_to_ue {
     namespace json {
-        bool export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data);
+        // Info.Version of both layouts, Info.Layout tells them apart. it continues after 1 (objects) and 2-3 (compact),
+        // so an older importer never takes a newer file for one it knows
+        constexpr int32_t version = 6;
+
+        bool export_to_file(const std::string& file_name, const gta_to_ue::Mesh& mesh_data, const ExportOptions& export_options);
+
+        // the frames, materials and geometries of a big mesh are serialized on up to num_workers threads, the file is the
+        // same for any count. the default of 1 serializes them on the calling thread
+        void set_num_workers(int32_t num_workers);
     }
 }
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstring>
+#include "common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define GTA2UE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace gta_to_ue {
+    namespace kernels {
+
+        static_assert(sizeof(rw::V3d) == 3 * sizeof(float));
+        static_assert(sizeof(rw::TexCoords) == 2 * sizeof(float));
+
+        /*
+         * converts an array of rw vectors into the stream: x' = (SwapXY ? y : x) * scale, y' = (SwapXY ? x : y) * (NegateY ? -scale : scale), z' = z * scale
+         * the stream must already be sized to hold count elements, cars use the swapped convention, everything else keeps rw axes
+         */
+        template <bool SwapXY, bool NegateY>
+        void convert_vectors(const rw::V3d* src, size_t count, float scale, Vector3Stream& dst)
+        {
+            const float* in = reinterpret_cast<const float*>(src);
+            float* out_x = dst.x.data();
+            float* out_y = dst.y.data();
+            float* out_z = dst.z.data();
+            const float scale_y = NegateY ? -scale : scale;
+
+            size_t i = 0;
+#if GTA2UE_SSE2
+            const __m128 scale_xz4 = _mm_set1_ps(scale);
+            const __m128 scale_y4 = _mm_set1_ps(scale_y);
+            for (; i + 4 <= count; i += 4) {
+                // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+                const __m128 a = _mm_loadu_ps(in + i * 3);
+                const __m128 b = _mm_loadu_ps(in + i * 3 + 4);
+                const __m128 c = _mm_loadu_ps(in + i * 3 + 8);
+
+                const __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+                const __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+                _mm_storeu_ps(out_x + i, _mm_mul_ps(SwapXY ? y : x, scale_xz4));
+                _mm_storeu_ps(out_y + i, _mm_mul_ps(SwapXY ? x : y, scale_y4));
+                _mm_storeu_ps(out_z + i, _mm_mul_ps(z, scale_xz4));
+            }
+#endif
+            for (; i < count; i++) {
+                out_x[i] = (SwapXY ? src[i].y : src[i].x) * scale;
+                out_y[i] = (SwapXY ? src[i].x : src[i].y) * scale_y;
+                out_z[i] = src[i].z * scale;
+            }
+        }
+
+        // the stream must already be sized to hold count elements
+        inline void convert_tex_coordinates(const rw::TexCoords* src, size_t count, Vector2Stream& dst)
+        {
+            const float* in = reinterpret_cast<const float*>(src);
+            float* out_u = dst.x.data();
+            float* out_v = dst.y.data();
+
+            size_t i = 0;
+#if GTA2UE_SSE2
+            for (; i + 4 <= count; i += 4) {
+                // a = u0 v0 u1 v1, b = u2 v2 u3 v3
+                const __m128 a = _mm_loadu_ps(in + i * 2);
+                const __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+                _mm_storeu_ps(out_u + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_storeu_ps(out_v + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+#endif
+            for (; i < count; i++) {
+                out_u[i] = src[i].u;
+                out_v[i] = src[i].v;
+            }
+        }
+
+        /*
+         * texture kernels, every output pixel is 4 bytes r, g, b, a
+         */
+
+        // d3d A8R8G8B8 (b, g, r, a in memory) or X8R8G8B8 with ForceOpaque
+        template <bool ForceOpaque>
+        void convert_bgra(const uint8_t* src, size_t count, uint8_t* dst)
+        {
+            size_t i = 0;
+#if GTA2UE_SSE2
+            const __m128i green_alpha_mask = _mm_set1_epi32(static_cast<int32_t>(0xFF00FF00));
+            const __m128i blue_red_mask = _mm_set1_epi32(0x000000FF);
+            const __m128i opaque = _mm_set1_epi32(ForceOpaque ? static_cast<int32_t>(0xFF000000) : 0);
+            for (; i + 4 <= count; i += 4) {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+                const __m128i blue = _mm_slli_epi32(_mm_and_si128(p, blue_red_mask), 16);
+                const __m128i red = _mm_and_si128(_mm_srli_epi32(p, 16), blue_red_mask);
+                const __m128i rgba = _mm_or_si128(_mm_or_si128(_mm_and_si128(p, green_alpha_mask), _mm_or_si128(red, blue)), opaque);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+            }
+#endif
+            for (; i < count; i++) {
+                dst[i * 4 + 0] = src[i * 4 + 2];
+                dst[i * 4 + 1] = src[i * 4 + 1];
+                dst[i * 4 + 2] = src[i * 4 + 0];
+                dst[i * 4 + 3] = ForceOpaque ? 0xFF : src[i * 4 + 3];
+            }
+        }
+
+        // a channel of Bits bits at Shift widened to 8 bits by repeating its high bits, 0 bits is opaque alpha
+        template <int32_t Shift, int32_t Bits>
+        inline uint32_t expand_channel(uint32_t pixel)
+        {
+            if constexpr (Bits == 0) {
+                return 0xFF;
+            } else if constexpr (Bits == 1) {
+                return (pixel >> Shift) & 1 ? 0xFF : 0;
+            } else {
+                const uint32_t value = (pixel >> Shift) & ((1 << Bits) - 1);
+                return (value << (8 - Bits)) | (value >> (2 * Bits - 8));
+            }
+        }
+
+#if GTA2UE_SSE2
+        template <int32_t Shift, int32_t Bits>
+        inline __m128i expand_channel(__m128i pixels)
+        {
+            if constexpr (Bits == 0) {
+                return _mm_set1_epi16(0xFF);
+            } else if constexpr (Bits == 1) {
+                return _mm_and_si128(_mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(_mm_srli_epi16(pixels, Shift), _mm_set1_epi16(1))), _mm_set1_epi16(0xFF));
+            } else {
+                const __m128i value = _mm_and_si128(_mm_srli_epi16(pixels, Shift), _mm_set1_epi16((1 << Bits) - 1));
+                return _mm_or_si128(_mm_slli_epi16(value, 8 - Bits), _mm_srli_epi16(value, 2 * Bits - 8));
+            }
+        }
+#endif
+
+        // 16-bit d3d pixels, the channels are given as shift and bit count, e.g. R5G6B5 is <11, 5, 5, 6, 0, 5, 0, 0>
+        template <int32_t RShift, int32_t RBits, int32_t GShift, int32_t GBits, int32_t BShift, int32_t BBits, int32_t AShift, int32_t ABits>
+        void convert_16bit(const uint8_t* src, size_t count, uint8_t* dst)
+        {
+            size_t i = 0;
+#if GTA2UE_SSE2
+            for (; i + 8 <= count; i += 8) {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                const __m128i red_green = _mm_or_si128(expand_channel<RShift, RBits>(p), _mm_slli_epi16(expand_channel<GShift, GBits>(p), 8));
+                const __m128i blue_alpha = _mm_or_si128(expand_channel<BShift, BBits>(p), _mm_slli_epi16(expand_channel<AShift, ABits>(p), 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_unpacklo_epi16(red_green, blue_alpha));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), _mm_unpackhi_epi16(red_green, blue_alpha));
+            }
+#endif
+            for (; i < count; i++) {
+                const uint32_t pixel = src[i * 2] | (src[i * 2 + 1] << 8);
+                dst[i * 4 + 0] = static_cast<uint8_t>(expand_channel<RShift, RBits>(pixel));
+                dst[i * 4 + 1] = static_cast<uint8_t>(expand_channel<GShift, GBits>(pixel));
+                dst[i * 4 + 2] = static_cast<uint8_t>(expand_channel<BShift, BBits>(pixel));
+                dst[i * 4 + 3] = static_cast<uint8_t>(expand_channel<AShift, ABits>(pixel));
+            }
+        }
+
+        // palette entries are r, g, b, a, sse2 has no gather so the lookups stay scalar
+        inline void expand_palette(const uint8_t* indices, size_t count, const uint8_t* palette, uint8_t* dst)
+        {
+            const uint32_t* colors = reinterpret_cast<const uint32_t*>(palette);
+            uint32_t* out = reinterpret_cast<uint32_t*>(dst);
+            for (size_t i = 0; i < count; i++) {
+                std::memcpy(out + i, colors + indices[i], 4);
+            }
+        }
+
+        // the 4 colors of a dxt color block, r, g, b, a packed little-endian. DXT1 blocks with color0 <= color1
+        // have 3 colors and transparent black, the DXT3 color blocks always have 4
+        inline void get_dxt_colors(const uint8_t* block, bool allow_transparent, uint32_t (&colors)[4])
+        {
+            const uint32_t color0 = block[0] | (block[1] << 8);
+            const uint32_t color1 = block[2] | (block[3] << 8);
+            uint32_t channels[2][3];
+            for (int32_t i = 0; i < 2; i++) {
+                const uint32_t color = i == 0 ? color0 : color1;
+                channels[i][0] = expand_channel<11, 5>(color);
+                channels[i][1] = expand_channel<5, 6>(color);
+                channels[i][2] = expand_channel<0, 5>(color);
+            }
+
+            uint32_t mixed[2][3];
+            const bool four_colors = !allow_transparent || color0 > color1;
+            for (int32_t c = 0; c < 3; c++) {
+                mixed[0][c] = four_colors ? (2 * channels[0][c] + channels[1][c]) / 3 : (channels[0][c] + channels[1][c]) / 2;
+                mixed[1][c] = four_colors ? (channels[0][c] + 2 * channels[1][c]) / 3 : 0;
+            }
+
+            colors[0] = channels[0][0] | (channels[0][1] << 8) | (channels[0][2] << 16) | 0xFF000000;
+            colors[1] = channels[1][0] | (channels[1][1] << 8) | (channels[1][2] << 16) | 0xFF000000;
+            colors[2] = mixed[0][0] | (mixed[0][1] << 8) | (mixed[0][2] << 16) | 0xFF000000;
+            colors[3] = four_colors ? mixed[1][0] | (mixed[1][1] << 8) | (mixed[1][2] << 16) | 0xFF000000 : 0;
+        }
+
+        // 4x4 pixels of a dxt color block, with the 16 4-bit alphas of a DXT3 block replacing the color alpha.
+        // pixels are written row by row with stride bytes between the rows, only width x height of them (edge blocks)
+        inline void decode_dxt_block(const uint8_t* color_block, const uint8_t* alpha_block, uint8_t* dst, size_t stride, int32_t width, int32_t height)
+        {
+            uint32_t colors[4];
+            get_dxt_colors(color_block, alpha_block == nullptr, colors);
+            const uint32_t indices = color_block[4] | (color_block[5] << 8) | (color_block[6] << 16) | (static_cast<uint32_t>(color_block[7]) << 24);
+
+            alignas(16) uint32_t pixels[16];
+#if GTA2UE_SSE2
+            // every pixel picks its color through compare masks, sse2 has no variable shuffle
+            const __m128i color_vectors[4] = { _mm_set1_epi32(colors[0]), _mm_set1_epi32(colors[1]), _mm_set1_epi32(colors[2]), _mm_set1_epi32(colors[3]) };
+            for (int32_t y = 0; y < 4; y++) {
+                const uint32_t row = indices >> (y * 8);
+                const __m128i index = _mm_setr_epi32(row & 3, (row >> 2) & 3, (row >> 4) & 3, (row >> 6) & 3);
+                __m128i pixel = _mm_setzero_si128();
+                for (int32_t c = 0; c < 4; c++) {
+                    pixel = _mm_or_si128(pixel, _mm_and_si128(_mm_cmpeq_epi32(index, _mm_set1_epi32(c)), color_vectors[c]));
+                }
+                _mm_store_si128(reinterpret_cast<__m128i*>(pixels + y * 4), pixel);
+            }
+
+            if (alpha_block) {
+                // 16 nibbles in pixel order, widened to 8 bits and moved to the alpha byte
+                const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(alpha_block));
+                const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+                const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(packed, nibble_mask), _mm_and_si128(_mm_srli_epi16(packed, 4), nibble_mask));
+                const __m128i alphas = _mm_or_si128(nibbles, _mm_slli_epi16(nibbles, 4));
+                const __m128i color_mask = _mm_set1_epi32(0x00FFFFFF);
+                const __m128i alpha_words[2] = { _mm_unpacklo_epi8(_mm_setzero_si128(), alphas), _mm_unpackhi_epi8(_mm_setzero_si128(), alphas) };
+                for (int32_t i = 0; i < 4; i++) {
+                    const __m128i alpha = i % 2 == 0 ? _mm_unpacklo_epi16(_mm_setzero_si128(), alpha_words[i / 2]) : _mm_unpackhi_epi16(_mm_setzero_si128(), alpha_words[i / 2]);
+                    __m128i* row = reinterpret_cast<__m128i*>(pixels + i * 4);
+                    _mm_store_si128(row, _mm_or_si128(_mm_and_si128(_mm_load_si128(row), color_mask), alpha));
+                }
+            }
+#else
+            for (int32_t i = 0; i < 16; i++) {
+                pixels[i] = colors[(indices >> (i * 2)) & 3];
+                if (alpha_block) {
+                    const uint32_t alpha = (alpha_block[i / 2] >> ((i % 2) * 4)) & 0x0F;
+                    pixels[i] = (pixels[i] & 0x00FFFFFF) | ((alpha | (alpha << 4)) << 24);
+                }
+            }
+#endif
+
+            for (int32_t y = 0; y < height; y++) {
+                std::memcpy(dst + y * stride, pixels + y * 4, width * 4);
+            }
+        }
+    }
+}
@@ -0,0 +1,381 @@
+#include "lod.h"
+#include "optimize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+constexpr int32_t max_simplify_passes = 64;
+
+struct Quadric
+{
+    double a00{ 0 }, a01{ 0 }, a02{ 0 }, a11{ 0 }, a12{ 0 }, a22{ 0 };
+    double b0{ 0 }, b1{ 0 }, b2{ 0 };
+    double c{ 0 };
+
+    void add(const Quadric& other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+    }
+
+    double get_error(const gta_to_ue::Vector3f& p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+        return a00 * x * x + a11 * y * y + a22 * z * z
+            + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+            + 2 * (b0 * x + b1 * y + b2 * z) + c;
+    }
+};
+
+// area weighted quadric of the triangle plane
+Quadric get_plane_quadric(const gta_to_ue::Vector3f& p0, const gta_to_ue::Vector3f& p1, const gta_to_ue::Vector3f& p2)
+{
+    const double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+    const double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+    double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+    const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+    Quadric quadric;
+    if (length == 0) {
+        return quadric;
+    }
+
+    n[0] /= length;
+    n[1] /= length;
+    n[2] /= length;
+    const double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+    const double w = length * 0.5;
+
+    quadric.a00 = w * n[0] * n[0];
+    quadric.a01 = w * n[0] * n[1];
+    quadric.a02 = w * n[0] * n[2];
+    quadric.a11 = w * n[1] * n[1];
+    quadric.a12 = w * n[1] * n[2];
+    quadric.a22 = w * n[2] * n[2];
+    quadric.b0 = w * n[0] * d;
+    quadric.b1 = w * n[1] * d;
+    quadric.b2 = w * n[2] * d;
+    quadric.c = w * d * d;
+    return quadric;
+}
+
+gta_to_ue::Vector3f get_triangle_normal(const gta_to_ue::Vector3f& p0, const gta_to_ue::Vector3f& p1, const gta_to_ue::Vector3f& p2)
+{
+    const gta_to_ue::Vector3f e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+    const gta_to_ue::Vector3f e2(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+    return gta_to_ue::Vector3f(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+}
+
+// maps every vertex to the first vertex with the same position, uv seams and hard edges split positions into several vertices
+std::vector<uint32_t> build_position_remap(const gta_to_ue::Geometry& geometry)
+{
+    struct PositionHash
+    {
+        size_t operator()(const gta_to_ue::Vector3f& p) const
+        {
+            uint32_t bits[3];
+            std::memcpy(&bits[0], &p.x, 4);
+            std::memcpy(&bits[1], &p.y, 4);
+            std::memcpy(&bits[2], &p.z, 4);
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+    struct PositionEqual
+    {
+        bool operator()(const gta_to_ue::Vector3f& a, const gta_to_ue::Vector3f& b) const
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+
+    std::vector<uint32_t> remap(geometry.vertices.size());
+    std::unordered_map<gta_to_ue::Vector3f, uint32_t, PositionHash, PositionEqual> positions;
+    positions.reserve(geometry.vertices.size());
+    for (uint32_t i = 0; i < geometry.vertices.size(); i++) {
+        remap[i] = positions.emplace(geometry.vertices[i], i).first->second;
+    }
+    return remap;
+}
+
+// vertices that must not move: shared by several vertices of one position, on an open or non-manifold edge,
+// or on a boundary between materials
+std::vector<bool> find_locked_vertices(const gta_to_ue::Geometry& geometry, const std::vector<uint32_t>& position_remap)
+{
+    const size_t num_vertices = geometry.vertices.size();
+    std::vector<bool> locked(num_vertices, false);
+
+    std::vector<uint32_t> num_wedges(num_vertices, 0);
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        num_wedges[position_remap[i]]++;
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edges;
+    std::vector<int32_t> vertex_material(num_vertices, -1);
+    std::vector<bool> material_boundary(num_vertices, false);
+    for (size_t t = 0; t < geometry.get_num_triangles(); t++) {
+        for (int32_t e = 0; e < 3; e++) {
+            const uint32_t a = position_remap[geometry.indices[t * 3 + e]];
+            const uint32_t b = position_remap[geometry.indices[t * 3 + (e + 1) % 3]];
+            edges[(static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b)]++;
+
+            int32_t& material = vertex_material[a];
+            if (material == -1) {
+                material = geometry.material_ids[t];
+            } else if (material != geometry.material_ids[t]) {
+                material_boundary[a] = true;
+            }
+        }
+    }
+
+    std::vector<bool> border(num_vertices, false);
+    for (const auto& [edge, count] : edges) {
+        if (count != 2) {
+            border[edge >> 32] = true;
+            border[edge & 0xFFFFFFFF] = true;
+        }
+    }
+
+    for (uint32_t i = 0; i < num_vertices; i++) {
+        const uint32_t p = position_remap[i];
+        locked[i] = num_wedges[p] > 1 || border[p] || material_boundary[p];
+    }
+    return locked;
+}
+
+// removes the triangles that lost an edge in the collapses, the unreferenced vertices are dropped afterwards
+size_t remove_degenerate_triangles(gta_to_ue::Geometry& geometry)
+{
+    size_t num_triangles = 0;
+    for (size_t t = 0; t < geometry.get_num_triangles(); t++) {
+        const uint32_t a = geometry.indices[t * 3 + 0];
+        const uint32_t b = geometry.indices[t * 3 + 1];
+        const uint32_t c = geometry.indices[t * 3 + 2];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        geometry.indices.set(num_triangles * 3 + 0, a);
+        geometry.indices.set(num_triangles * 3 + 1, b);
+        geometry.indices.set(num_triangles * 3 + 2, c);
+        geometry.material_ids[num_triangles] = geometry.material_ids[t];
+        num_triangles++;
+    }
+    geometry.indices.resize(num_triangles * 3);
+    geometry.material_ids.resize(num_triangles);
+    return num_triangles;
+}
+
+int32_t gta_to_ue::lod::get_lod_level(const std::string& frame_name)
+{
+    const std::string_view name(frame_name.c_str());
+    if (name.ends_with("_vlo")) {
+        return 2;
+    }
+    if (name.ends_with("_lo")) {
+        return 1;
+    }
+    return 0;
+}
+
+void gta_to_ue::lod::assign_lod_levels(Mesh& mesh)
+{
+    bool has_level[3] = {};
+    for (auto& geometry : mesh.geometries) {
+        geometry.lod_level = get_lod_level(mesh.frames[geometry.frame_id].name);
+        has_level[geometry.lod_level] = true;
+    }
+
+    // a model with only *_vlo geometries gets them as level 1
+    if (!has_level[1] && has_level[2]) {
+        for (auto& geometry : mesh.geometries) {
+            if (geometry.lod_level == 2) {
+                geometry.lod_level = 1;
+            }
+        }
+    }
+}
+
+int32_t gta_to_ue::lod::get_num_lod_levels(const Mesh& mesh)
+{
+    int32_t max_level = 0;
+    for (auto& geometry : mesh.geometries) {
+        max_level = std::max(max_level, geometry.lod_level);
+    }
+    return max_level + 1;
+}
+
+size_t gta_to_ue::lod::simplify(Geometry& geometry, size_t target_num_triangles)
+{
+    const size_t num_vertices = geometry.vertices.size();
+    size_t num_triangles = geometry.get_num_triangles();
+    if (num_triangles <= target_num_triangles) {
+        return num_triangles;
+    }
+
+    const std::vector<uint32_t> position_remap = build_position_remap(geometry);
+    const std::vector<bool> locked = find_locked_vertices(geometry, position_remap);
+
+    std::vector<Quadric> quadrics(num_vertices);
+    for (size_t t = 0; t < num_triangles; t++) {
+        const uint32_t a = geometry.indices[t * 3 + 0];
+        const uint32_t b = geometry.indices[t * 3 + 1];
+        const uint32_t c = geometry.indices[t * 3 + 2];
+        const Quadric quadric = get_plane_quadric(geometry.vertices[a], geometry.vertices[b], geometry.vertices[c]);
+        quadrics[position_remap[a]].add(quadric);
+        quadrics[position_remap[b]].add(quadric);
+        quadrics[position_remap[c]].add(quadric);
+    }
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double error;
+    };
+
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> triangle_offsets(num_vertices + 1);
+    std::vector<uint32_t> vertex_triangles;
+    std::vector<bool> touched(num_vertices);
+
+    for (int32_t pass = 0; pass < max_simplify_passes && num_triangles > target_num_triangles; pass++) {
+        // vertex -> triangles adjacency of the current index buffer
+        std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+        for (size_t i = 0; i < num_triangles * 3; i++) {
+            triangle_offsets[geometry.indices[i] + 1]++;
+        }
+        for (size_t i = 0; i < num_vertices; i++) {
+            triangle_offsets[i + 1] += triangle_offsets[i];
+        }
+        vertex_triangles.resize(num_triangles * 3);
+        std::vector<uint32_t> fill(triangle_offsets.begin(), triangle_offsets.end() - 1);
+        for (size_t i = 0; i < num_triangles * 3; i++) {
+            vertex_triangles[fill[geometry.indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t t = 0; t < num_triangles; t++) {
+            for (int32_t e = 0; e < 3; e++) {
+                const uint32_t from = geometry.indices[t * 3 + e];
+                const uint32_t to = geometry.indices[t * 3 + (e + 1) % 3];
+                if (locked[from]) {
+                    continue;
+                }
+                Quadric quadric = quadrics[position_remap[from]];
+                quadric.add(quadrics[position_remap[to]]);
+                collapses.push_back(Collapse{ from, to, quadric.get_error(geometry.vertices[to]) });
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.error < b.error || (a.error == b.error && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        // every interior collapse removes two triangles
+        const size_t max_collapses = std::max<size_t>((num_triangles - target_num_triangles) / 2, 1);
+        std::vector<uint32_t> remap(num_vertices);
+        for (uint32_t i = 0; i < num_vertices; i++) {
+            remap[i] = i;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        size_t num_collapses = 0;
+        for (const Collapse& collapse : collapses) {
+            if (num_collapses >= max_collapses) {
+                break;
+            }
+            if (touched[position_remap[collapse.from]] || touched[position_remap[collapse.to]]) {
+                continue;
+            }
+
+            // the triangles that keep existing must not flip or collapse to a line
+            bool valid = true;
+            const gta_to_ue::Vector3f& target = geometry.vertices[collapse.to];
+            for (uint32_t i = triangle_offsets[collapse.from]; i < triangle_offsets[collapse.from + 1] && valid; i++) {
+                const uint32_t t = vertex_triangles[i];
+                const uint32_t corners[3] = { geometry.indices[t * 3 + 0], geometry.indices[t * 3 + 1], geometry.indices[t * 3 + 2] };
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                    continue;
+                }
+
+                gta_to_ue::Vector3f p[3] = { geometry.vertices[corners[0]], geometry.vertices[corners[1]], geometry.vertices[corners[2]] };
+                const gta_to_ue::Vector3f before = get_triangle_normal(p[0], p[1], p[2]);
+                for (int32_t c = 0; c < 3; c++) {
+                    if (corners[c] == collapse.from) {
+                        p[c] = target;
+                    }
+                }
+                const gta_to_ue::Vector3f after = get_triangle_normal(p[0], p[1], p[2]);
+                const float dot = before.x * after.x + before.y * after.y + before.z * after.z;
+                const float after_length = after.x * after.x + after.y * after.y + after.z * after.z;
+                valid = dot > 0.f && after_length > 0.f;
+            }
+            if (!valid) {
+                continue;
+            }
+
+            // the neighbourhood of the collapse is frozen for the rest of the pass so every check above stays valid
+            for (uint32_t i = triangle_offsets[collapse.from]; i < triangle_offsets[collapse.from + 1]; i++) {
+                const uint32_t t = vertex_triangles[i];
+                for (int32_t c = 0; c < 3; c++) {
+                    touched[position_remap[geometry.indices[t * 3 + c]]] = true;
+                }
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[position_remap[collapse.to]].add(quadrics[position_remap[collapse.from]]);
+            num_collapses++;
+        }
+
+        if (num_collapses == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < num_triangles * 3; i++) {
+            geometry.indices.set(i, remap[geometry.indices[i]]);
+        }
+        num_triangles = remove_degenerate_triangles(geometry);
+    }
+
+    gta_to_ue::optimize::optimize_vertex_fetch(geometry);
+
+    return num_triangles;
+}
+
+void gta_to_ue::lod::generate_lods(Mesh& mesh, const std::vector<float>& ratios)
+{
+    if (get_num_lod_levels(mesh) > 1) {
+        return;
+    }
+
+    const size_t num_source_geometries = mesh.geometries.size();
+    const size_t num_source_instances = mesh.instances.size();
+    for (size_t level = 0; level < ratios.size(); level++) {
+        for (size_t i = 0; i < num_source_geometries; i++) {
+            Geometry geometry(mesh.geometries[i]);
+            geometry.lod_level = static_cast<int32_t>(level + 1);
+            const size_t target_num_triangles = static_cast<size_t>(geometry.get_num_triangles() * std::clamp(ratios[level], 0.f, 1.f));
+            if (simplify(geometry, target_num_triangles) == 0) {
+                continue;
+            }
+
+            const int32_t geometry_id = static_cast<int32_t>(mesh.geometries.size());
+            mesh.geometries.push_back(std::move(geometry));
+
+            // simplified wheels are placed on the same dummies as the originals
+            for (size_t j = 0; j < num_source_instances; j++) {
+                if (mesh.instances[j].geometry_id == static_cast<int32_t>(i)) {
+                    GeometryInstance instance = mesh.instances[j];
+                    instance.geometry_id = geometry_id;
+                    mesh.instances.push_back(instance);
+                }
+            }
+        }
+    }
+}
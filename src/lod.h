@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace lod {
+        // lod level of a geometry attached to the frame: 1 for *_lo, 2 for *_vlo, 0 otherwise
+        int32_t get_lod_level(const std::string& frame_name);
+
+        // tags the *_lo and *_vlo geometries with their lod level, levels are renumbered so they have no gaps
+        void assign_lod_levels(gta_to_ue::Mesh& mesh);
+
+        int32_t get_num_lod_levels(const gta_to_ue::Mesh& mesh);
+
+        // quadric error simplifier, collapses interior vertices onto their neighbours until the geometry has at most
+        // target_num_triangles triangles or nothing can be collapsed anymore. seam, border and material boundary
+        // vertices are kept in place so the uv layout and the outline survive, returns the number of triangles left
+        size_t simplify(gta_to_ue::Geometry& geometry, size_t target_num_triangles);
+
+        // adds a simplified copy of every level 0 geometry for each ratio, only for meshes without lods of their own
+        void generate_lods(gta_to_ue::Mesh& mesh, const std::vector<float>& ratios);
+    }
+}
@@ -3,53 +3,105 @@
 #include <fstream>
 #include <cxxopts.hpp>
 #include "common.h"
+#include "batch.h"
+#include "cache.h"
+#include "converter.h"
 #include "dff.h"
+#include "engine.h"
 #include "json.h"
+#include "profile.h"
+#include "serve.h"
+#include "txd.h"
+#include "worker_pool.h"
 
-bool init_rw()
+// prints the profile summary and writes the trace of a profiled run. serve mode passes std::cerr, its stdout only carries responses
+int32_t finish_profile(int32_t exit_code, const std::string& trace_file, std::ostream& stream = std::cout)
 {
-    rw::platform = rw::PLATFORM_GL3;
-    if (!rw::Engine::init()) {
-        return false;
+    if (!gta_to_ue::profile::is_enabled()) {
+        return exit_code;
     }
 
-    gta::attachPlugins();
-
-    if (!rw::Engine::open(nil)) {
-        return false;
+    gta_to_ue::profile::print_summary(stream);
+    if (!trace_file.empty()) {
+        if (gta_to_ue::profile::write_trace(trace_file)) {
+            stream << "trace: " << trace_file << std::endl;
+        } else {
+            stream << "file: " << trace_file << " writing error" << std::endl;
+        }
     }
 
-    if (!rw::Engine::start()) {
-        return false;
-    }
+    return exit_code;
+}
 
-    rw::Texture::setLoadTextures(false);
-    rw::Texture::setCreateDummies(true);
+// extracts the textures referenced by the converted files, the exit code turns non-zero if it fails
+int32_t finish_textures(int32_t exit_code, const std::vector<std::string>& txd_files, const std::string& texture_dir, gta_to_ue::txd::TextureFormat texture_format, int32_t num_workers)
+{
+    if (txd_files.empty()) {
+        return exit_code;
+    }
 
-    return true;
+    std::cout << "textures: " << (texture_dir.empty() ? "." : texture_dir) << std::endl;
+    return gta_to_ue::txd::extract(txd_files, texture_dir, texture_format, num_workers) ? exit_code : 1;
 }
 
 int main(int argc, char** argv)
 {
     cxxopts::Options options("gta2ue_converter", "GTA 3 & GTA VC DFF files converter");
 
-    options.custom_help("[-h|--help] [-d|--dff <dff file> [--car [--wheels <wheels file> [--wheel-id <wheel-id>] [--wheel-scale <float>]] -o|--output <output file>]");
+    options.custom_help("[-h|--help] [-d|--dff <dff file> | --batch <dir|list file> | --img <img file> [--match <pattern>] | --serve | --socket <path>] [-j|--jobs <num>] [--no-cache] [--profile [--trace <trace file>]] [--car [--wheels <wheels file> [--wheel-id <wheel-id>] [--wheel-scale <float>]] [--optimize] [--lod-ratios <r1,r2,...>] [--morph-threshold <float>] [--format json|bin [--quantize [--normal-bits 8|16]]] [--json-layout objects|compact] [--compress zstd[:level]] [--txd <txd files> [--texture-format png|dds] [--texture-dir <dir>]] -o|--output <output file|output dir>]");
 
     std::string input_dff_file;
+    std::string batch_source;
+    std::string img_file;
+    std::string socket_path;
+    std::string trace_file;
+    std::string img_pattern{ "*.dff" };
+    int32_t num_workers = 0;
+    std::string output_format;
+    std::string json_layout;
+    std::string compression;
+    int32_t normal_bits;
     std::string input_wheels_file;
     std::string output_file;
     float wheel_scale;
     int32_t wheel_id;
+    std::vector<float> lod_ratios;
+    std::vector<std::string> txd_files;
+    std::string texture_format_name;
+    std::string texture_dir;
+    gta_to_ue::txd::TextureFormat texture_format = gta_to_ue::txd::TextureFormat::png;
+    float morph_threshold;
     ConvertingOptions converting_options;
+    ExportOptions export_options;
 
     options.add_options()
         ("h,help", "print usage")
         ("d,dff", "input *.dff file", cxxopts::value(input_dff_file))
-        ("o,output", "output *.dffjson file", cxxopts::value(output_file))
+        ("o,output", "output *.dffjson/*.dffbin file, or output directory in batch mode", cxxopts::value(output_file))
+        ("format", "output format: json (default) or bin", cxxopts::value(output_format))
+        ("quantize", "bin format: 16-bit positions and uvs, octahedral normals and varint delta indices, see src/bin.h")
+        ("normal-bits", "bits per octahedral normal component of --quantize: 8 or 16 (default)", cxxopts::value(normal_bits))
+        ("json-layout", "json geometry layout: objects (default) or compact flat arrays", cxxopts::value(json_layout))
+        ("compress", "compress the outputs while they are written: none (default) or zstd[:level], level 1-22 (default 3), adds .zst to the extension", cxxopts::value(compression))
+        ("txd", "comma separated *.txd files to extract the textures used by the converted materials from, in single file and batch modes", cxxopts::value(txd_files))
+        ("texture-format", "extracted texture format: png (default) or dds, dds keeps dxt textures compressed", cxxopts::value(texture_format_name))
+        ("texture-dir", "output directory of the extracted textures, default next to the outputs", cxxopts::value(texture_dir))
+        ("batch", "directory with *.dff files or a text file with one *.dff path per line", cxxopts::value(batch_source))
+        ("img", "gta3/vc *.img archive (with its *.dir file next to it) to convert entries from", cxxopts::value(img_file))
+        ("match", "name pattern of the img entries to convert, * and ? wildcards, default *.dff", cxxopts::value(img_pattern))
+        ("j,jobs", "number of worker threads in batch and serve modes, or for the atomics and the json sections of a single dff", cxxopts::value(num_workers))
+        ("serve", "keep running and convert the json line requests read from stdin, see src/serve.h")
+        ("socket", "keep running and convert the json line requests of the unix domain socket connections", cxxopts::value(socket_path))
+        ("profile", "time the conversion stages and print a summary table with vertex, triangle, material and byte counters")
+        ("trace", "with profiling, write a chrome trace event json file with a span per stage and file", cxxopts::value(trace_file))
+        ("no-cache", "convert every file in batch mode, even if its output is up to date in the .gta2ue-cache manifest")
         ("wheels", "DFF file with wheels", cxxopts::value(input_wheels_file))
         ("wheel-id", "wheel id", cxxopts::value(wheel_id))
         ("wheel-scale", "wheel scale", cxxopts::value(wheel_scale))
-        ("car", "DFF is a car");
+        ("car", "DFF is a car")
+        ("lod-ratios", "comma separated triangle ratios of the lods generated for models without *_lo/*_vlo geometries, e.g. 0.5,0.25", cxxopts::value(lod_ratios))
+        ("morph-threshold", "morph target vertices moving at most this far (in output units) are left out of the target, default 0.01", cxxopts::value(morph_threshold))
+        ("optimize", "weld vertices and reorder triangles and vertices for the gpu vertex cache");
 
     options.allow_unrecognised_options();
 
@@ -59,6 +111,18 @@ int main(int argc, char** argv)
         converting_options.is_car = true;
 	}
 
+	if (result.count("optimize")) {
+		converting_options.optimize = true;
+	}
+
+	if (result.count("lod-ratios")) {
+		converting_options.lod_ratios = lod_ratios;
+	}
+
+	if (result.count("morph-threshold")) {
+		converting_options.morph_threshold = morph_threshold;
+	}
+
 	if (result.count("wheels")) {
 		converting_options.wheels_dff = input_wheels_file;
 	}
@@ -71,41 +135,160 @@ int main(int argc, char** argv)
         converting_options.wheel_scale = wheel_scale;
 	}
 
+    if (result.count("format")) {
+        if (output_format == "bin") {
+            export_options.format = OutputFormat::bin;
+        } else if (output_format != "json") {
+            std::cout << "unknown output format: " << output_format << ", use -h to print usage" << std::endl;
+            return 1;
+        }
+    }
+
+    if (result.count("json-layout")) {
+        if (json_layout == "compact") {
+            export_options.json_layout = JsonLayout::compact;
+        } else if (json_layout != "objects") {
+            std::cout << "unknown json layout: " << json_layout << ", use -h to print usage" << std::endl;
+            return 1;
+        }
+    }
+
+    if (result.count("quantize")) {
+        if (export_options.format != OutputFormat::bin) {
+            std::cout << "--quantize needs --format bin, use -h to print usage" << std::endl;
+            return 1;
+        }
+        export_options.quantize = true;
+    }
+
+    if (result.count("normal-bits")) {
+        if (normal_bits != 8 && normal_bits != 16) {
+            std::cout << "normal bits must be 8 or 16, use -h to print usage" << std::endl;
+            return 1;
+        }
+        export_options.normal_bits = normal_bits;
+    }
+
+    if (result.count("compress") && !gta_to_ue::parse_compression(compression, export_options)) {
+        std::cout << "unknown compression: " << compression << ", use -h to print usage" << std::endl;
+        return 1;
+    }
+
+    if (result.count("texture-format")) {
+        if (texture_format_name == "dds") {
+            texture_format = gta_to_ue::txd::TextureFormat::dds;
+        } else if (texture_format_name != "png") {
+            std::cout << "unknown texture format: " << texture_format_name << ", use -h to print usage" << std::endl;
+            return 1;
+        }
+    }
+
     if (result.count("help")) {
         std::cout << options.help() << std::endl;
         return 0;
     }
 
+    if (result.count("profile") || !trace_file.empty()) {
+        gta_to_ue::profile::enable(!trace_file.empty());
+    }
+
+    if (result.count("serve") || !socket_path.empty()) {
+        if (num_workers <= 0) {
+            num_workers = gta_to_ue::WorkerPool::get_default_num_workers();
+        }
+
+        if (!gta_to_ue::init_rw()) {
+            std::cout << "rw engine initialization error" << std::endl;
+            return 1;
+        }
+
+        return finish_profile(socket_path.empty()
+            ? gta_to_ue::serve::run_stdin(converting_options, export_options, num_workers)
+            : gta_to_ue::serve::run_socket(socket_path, converting_options, export_options, num_workers), trace_file, std::cerr);
+    }
+
+    if (!txd_files.empty()) {
+        gta_to_ue::txd::record_references();
+    }
+
+    gta_to_ue::img::Archive archive;
+    if (!batch_source.empty() || !img_file.empty()) {
+        std::vector<gta_to_ue::batch::Job> jobs;
+        if (!img_file.empty()) {
+            if (!archive.open(img_file)) {
+                return 1;
+            }
+            if (output_file.empty()) {
+                output_file = std::filesystem::path(img_file).parent_path().string();
+            }
+            if (!gta_to_ue::batch::collect_jobs(archive, img_pattern, output_file, export_options, jobs)) {
+                return 1;
+            }
+        } else if (!gta_to_ue::batch::collect_jobs(batch_source, output_file, export_options, jobs)) {
+            return 1;
+        }
+
+        if (num_workers <= 0) {
+            num_workers = gta_to_ue::WorkerPool::get_default_num_workers();
+        }
+
+        std::cout << "batch: " << (img_file.empty() ? batch_source : img_file) << " (" << jobs.size() << " files, " << num_workers << " workers)" << std::endl;
+
+        if (!gta_to_ue::init_rw()) {
+            std::cout << "rw engine initialization error" << std::endl;
+            return 1;
+        }
+
+        // the manifest sits next to the outputs: in the output directory, or next to the inputs without one
+        gta_to_ue::cache::Manifest manifest;
+        const bool use_cache = !result.count("no-cache");
+        if (use_cache) {
+            std::string cache_dir = output_file;
+            if (cache_dir.empty()) {
+                cache_dir = std::filesystem::is_directory(batch_source) ? batch_source : std::filesystem::path(batch_source).parent_path().string();
+            }
+            manifest.load(cache_dir);
+        }
+
+        const int32_t num_failed = gta_to_ue::batch::run(jobs, converting_options, export_options, num_workers, use_cache ? &manifest : nullptr);
+        if (texture_dir.empty()) {
+            texture_dir = !output_file.empty() ? output_file
+                : std::filesystem::is_directory(batch_source) ? batch_source : std::filesystem::path(batch_source).parent_path().string();
+        }
+        return finish_profile(finish_textures(num_failed == 0 ? 0 : 1, txd_files, texture_dir, texture_format, num_workers), trace_file);
+    }
+
     if (input_dff_file.empty()) {
         std::cout << "must specify input file, use -h to print usage" << std::endl;
         return 1;
     }
 
     if (output_file.empty()) {
-        const std::filesystem::path path = std::filesystem::path(input_dff_file);
-        const std::string ext = path.has_extension() ? path.extension().string() : "";
-        if (!ext.empty()) {
-            output_file = input_dff_file.substr(0, input_dff_file.length() - ext.length()) + ".dffjson";
-        }
+        output_file = gta_to_ue::get_default_output_file(input_dff_file, export_options);
     }
 
     std::cout << "input: " << input_dff_file << std::endl;
     std::cout << "output: " << output_file << std::endl;
 
-    if (!init_rw()) {
+    if (!gta_to_ue::init_rw()) {
         std::cout << "rw engine initialization error" << std::endl;
         return 1;
     }
-    
-    gta_to_ue::Mesh mesh;
-    if (rw::Clump* clump = gta_to_ue::dff::parse(input_dff_file, converting_options, mesh)) {
-        if (!gta_to_ue::json::export_to_file(output_file, mesh)) {
-            std::cout << "saving error" << std::endl;
-            return 1;
-        }
-        return 0;
+
+    // a single file spreads the atomics of its clump and the sections of its json over the workers instead
+    if (num_workers <= 0) {
+        num_workers = gta_to_ue::WorkerPool::get_default_num_workers();
+    }
+    gta_to_ue::dff::set_num_atomic_workers(num_workers);
+    gta_to_ue::json::set_num_workers(num_workers);
+
+    if (const gta_to_ue::ConvertingStatus status = gta_to_ue::convert(input_dff_file, output_file, converting_options, export_options); status != gta_to_ue::ConvertingStatus::ok) {
+        std::cout << gta_to_ue::to_string(status) << std::endl;
+        return finish_profile(1, trace_file);
     }
 
-    std::cout << "parsing error" << std::endl;
-    return 1;
+    if (texture_dir.empty()) {
+        texture_dir = std::filesystem::path(output_file).parent_path().string();
+    }
+    return finish_profile(finish_textures(0, txd_files, texture_dir, texture_format, num_workers), trace_file);
 }
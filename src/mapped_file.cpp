@@ -0,0 +1,143 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace gta_to_ue;
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& file_name)
+{
+    close();
+
+    HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    opened = true;
+    mapped_size = static_cast<size_t>(file_size.QuadPart);
+    if (mapped_size == 0) {
+        return true;
+    }
+
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        close();
+        return false;
+    }
+
+    mapped_data = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!mapped_data) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapped_data) {
+        UnmapViewOfFile(mapped_data);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle) {
+        CloseHandle(file_handle);
+    }
+
+    mapped_data = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    mapped_size = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& file_name)
+{
+    close();
+
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    opened = true;
+    mapped_size = static_cast<size_t>(file_stat.st_size);
+    if (mapped_size > 0) {
+        void* data = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            close();
+            return false;
+        }
+        mapped_data = static_cast<const uint8_t*>(data);
+    }
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapped_data) {
+        munmap(const_cast<uint8_t*>(mapped_data), mapped_size);
+    }
+
+    mapped_data = nullptr;
+    mapped_size = 0;
+    opened = false;
+}
+
+#endif
+
+const uint8_t* MappedFile::data() const
+{
+    return mapped_data;
+}
+
+size_t MappedFile::size() const
+{
+    return mapped_size;
+}
+
+bool MappedFile::is_open() const
+{
+    return opened;
+}
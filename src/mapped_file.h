@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace gta_to_ue {
+
+    // read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator = (const MappedFile&) = delete;
+
+        bool open(const std::string& file_name);
+        void close();
+
+        const uint8_t* data() const;
+        size_t size() const;
+        bool is_open() const;
+
+    private:
+        const uint8_t* mapped_data{ nullptr };
+        size_t mapped_size{ 0 };
+        bool opened{ false };
+#ifdef _WIN32
+        void* file_handle{ nullptr };
+        void* mapping_handle{ nullptr };
+#endif
+    };
+}
@@ -0,0 +1,93 @@
+#include "morph.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr uint32_t invalid_index = 0xFFFFFFFF;
+
+int16_t quantize(float value, float center, float extent)
+{
+    if (extent <= 0.f) {
+        return 0;
+    }
+    const float quantized = std::round((value - center) / extent * gta_to_ue::morph::quantization_scale);
+    return static_cast<int16_t>(std::clamp(quantized, -static_cast<float>(gta_to_ue::morph::quantization_scale), static_cast<float>(gta_to_ue::morph::quantization_scale)));
+}
+
+float dequantize(int16_t value, float min, float max)
+{
+    return (max + min) * 0.5f + value * ((max - min) * 0.5f) / gta_to_ue::morph::quantization_scale;
+}
+
+gta_to_ue::MorphTarget gta_to_ue::morph::build(const Vector3Stream& base_vertices, const Vector3Stream& target_vertices, float threshold)
+{
+    MorphTarget morph_target;
+    if (base_vertices.size() != target_vertices.size()) {
+        return morph_target;
+    }
+
+    std::vector<Vector3f> deltas;
+    for (size_t i = 0; i < base_vertices.size(); i++) {
+        const Vector3f delta(target_vertices.x[i] - base_vertices.x[i], target_vertices.y[i] - base_vertices.y[i], target_vertices.z[i] - base_vertices.z[i]);
+        if (std::max({ std::abs(delta.x), std::abs(delta.y), std::abs(delta.z) }) <= threshold) {
+            continue;
+        }
+
+        if (deltas.empty()) {
+            morph_target.delta_min = delta;
+            morph_target.delta_max = delta;
+        }
+        morph_target.delta_min = Vector3f(std::min(morph_target.delta_min.x, delta.x), std::min(morph_target.delta_min.y, delta.y), std::min(morph_target.delta_min.z, delta.z));
+        morph_target.delta_max = Vector3f(std::max(morph_target.delta_max.x, delta.x), std::max(morph_target.delta_max.y, delta.y), std::max(morph_target.delta_max.z, delta.z));
+        morph_target.vertex_ids.push_back(static_cast<uint32_t>(i));
+        deltas.push_back(delta);
+    }
+
+    const Vector3f& min = morph_target.delta_min;
+    const Vector3f& max = morph_target.delta_max;
+    morph_target.deltas.reserve(deltas.size() * 3);
+    for (const Vector3f& delta : deltas) {
+        morph_target.deltas.push_back(quantize(delta.x, (max.x + min.x) * 0.5f, (max.x - min.x) * 0.5f));
+        morph_target.deltas.push_back(quantize(delta.y, (max.y + min.y) * 0.5f, (max.y - min.y) * 0.5f));
+        morph_target.deltas.push_back(quantize(delta.z, (max.z + min.z) * 0.5f, (max.z - min.z) * 0.5f));
+    }
+
+    return morph_target;
+}
+
+gta_to_ue::Vector3f gta_to_ue::morph::get_delta(const MorphTarget& morph_target, size_t entry)
+{
+    const Vector3f& min = morph_target.delta_min;
+    const Vector3f& max = morph_target.delta_max;
+    return Vector3f(
+        dequantize(morph_target.deltas[entry * 3], min.x, max.x),
+        dequantize(morph_target.deltas[entry * 3 + 1], min.y, max.y),
+        dequantize(morph_target.deltas[entry * 3 + 2], min.z, max.z)
+    );
+}
+
+void gta_to_ue::morph::apply_vertex_remap(MorphTarget& morph_target, const std::vector<uint32_t>& remap, uint32_t num_new_vertices)
+{
+    std::vector<uint32_t> entries(num_new_vertices, invalid_index);
+    for (size_t i = 0; i < morph_target.vertex_ids.size(); i++) {
+        const uint32_t vertex_id = morph_target.vertex_ids[i];
+        if (vertex_id < remap.size() && remap[vertex_id] != invalid_index && entries[remap[vertex_id]] == invalid_index) {
+            entries[remap[vertex_id]] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // the entries stay sorted by vertex id
+    std::vector<uint32_t> vertex_ids;
+    std::vector<int16_t> deltas;
+    for (uint32_t vertex_id = 0; vertex_id < num_new_vertices; vertex_id++) {
+        const uint32_t entry = entries[vertex_id];
+        if (entry == invalid_index) {
+            continue;
+        }
+        vertex_ids.push_back(vertex_id);
+        deltas.insert(deltas.end(), morph_target.deltas.begin() + entry * 3, morph_target.deltas.begin() + entry * 3 + 3);
+    }
+
+    morph_target.vertex_ids = std::move(vertex_ids);
+    morph_target.deltas = std::move(deltas);
+}
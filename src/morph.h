@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace morph {
+        constexpr int32_t quantization_scale = 32767;
+
+        // sparse target of the vertices that move more than threshold on any axis against the base vertices
+        MorphTarget build(const Vector3Stream& base_vertices, const Vector3Stream& target_vertices, float threshold);
+
+        Vector3f get_delta(const MorphTarget& morph_target, size_t entry);
+
+        // moves the entries to the new vertex ids of a vertex remap, entries of dropped vertices are removed
+        // and vertices welded into one keep a single entry
+        void apply_vertex_remap(MorphTarget& morph_target, const std::vector<uint32_t>& remap, uint32_t num_new_vertices);
+    }
+}
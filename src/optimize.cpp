@@ -0,0 +1,388 @@
+#include "optimize.h"
+#include "morph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr uint32_t invalid_index = 0xFFFFFFFF;
+constexpr int32_t vertex_cache_size = 32;
+
+// moves every vertex to the position given by its remap entry, vertices with an invalid entry are dropped
+// and welded duplicates share an entry, the index buffer is rewritten with the new positions
+void apply_vertex_remap(gta_to_ue::Geometry& geometry, const std::vector<uint32_t>& remap, uint32_t num_new_vertices)
+{
+    auto remap_stream = [&remap, num_new_vertices](auto& stream) {
+        if (stream.size() != remap.size()) {
+            return;
+        }
+        std::remove_reference_t<decltype(stream)> new_stream(num_new_vertices, stream.front());
+        for (size_t i = 0; i < remap.size(); i++) {
+            if (remap[i] != invalid_index) {
+                new_stream[remap[i]] = stream[i];
+            }
+        }
+        stream = std::move(new_stream);
+    };
+
+    if (!remap.empty()) {
+        for (auto* stream : { &geometry.vertices, &geometry.normals }) {
+            remap_stream(stream->x);
+            remap_stream(stream->y);
+            remap_stream(stream->z);
+        }
+        for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+            remap_stream(tex_coordinate_set.x);
+            remap_stream(tex_coordinate_set.y);
+        }
+        if (geometry.has_skeleton) {
+            remap_stream(geometry.skeleton.weights);
+            remap_stream(geometry.skeleton.bone_indices);
+        }
+        for (auto& morph_target : geometry.morph_targets) {
+            gta_to_ue::morph::apply_vertex_remap(morph_target, remap, num_new_vertices);
+        }
+    }
+
+    gta_to_ue::IndexBuffer indices;
+    indices.reset(num_new_vertices);
+    indices.reserve(geometry.indices.size());
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        indices.push_back(remap[geometry.indices[i]]);
+    }
+    geometry.indices = std::move(indices);
+}
+
+uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+bool same_bytes(const T& a, const T& b)
+{
+    return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+void gta_to_ue::optimize::weld_vertices(Geometry& geometry)
+{
+    const size_t num_vertices = geometry.vertices.size();
+    if (num_vertices == 0) {
+        return;
+    }
+
+    const bool has_normals = geometry.normals.size() == num_vertices;
+    const bool has_skin = geometry.has_skeleton && geometry.skeleton.weights.size() == num_vertices && geometry.skeleton.bone_indices.size() == num_vertices;
+
+    // morph target entry of every vertex, vertices only weld if they move the same way in every target
+    std::vector<std::vector<uint32_t>> morph_entries(geometry.morph_targets.size(), std::vector<uint32_t>(num_vertices, invalid_index));
+    for (size_t t = 0; t < geometry.morph_targets.size(); t++) {
+        const auto& vertex_ids = geometry.morph_targets[t].vertex_ids;
+        for (size_t i = 0; i < vertex_ids.size(); i++) {
+            if (vertex_ids[i] < num_vertices) {
+                morph_entries[t][vertex_ids[i]] = static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    auto get_morph_delta = [&](size_t t, size_t i) {
+        const uint32_t entry = morph_entries[t][i];
+        return entry == invalid_index ? nullptr : &geometry.morph_targets[t].deltas[entry * 3];
+    };
+
+    auto hash_vertex = [&](size_t i) {
+        const Vector3f vertex = geometry.vertices[i];
+        uint64_t hash = hash_bytes(0xCBF29CE484222325ull, &vertex, sizeof(Vector3f));
+        if (has_normals) {
+            const Vector3f normal = geometry.normals[i];
+            hash = hash_bytes(hash, &normal, sizeof(Vector3f));
+        }
+        for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+            const Vector2f tex_coordinate = tex_coordinate_set[i];
+            hash = hash_bytes(hash, &tex_coordinate, sizeof(Vector2f));
+        }
+        if (has_skin) {
+            hash = hash_bytes(hash, &geometry.skeleton.weights[i], sizeof(VertexWeight));
+            hash = hash_bytes(hash, &geometry.skeleton.bone_indices[i], sizeof(BoneIndex));
+        }
+        for (size_t t = 0; t < morph_entries.size(); t++) {
+            if (const int16_t* delta = get_morph_delta(t, i)) {
+                hash = hash_bytes(hash, delta, 3 * sizeof(int16_t));
+            }
+        }
+        return hash;
+    };
+
+    auto same_vertex = [&](size_t a, size_t b) {
+        if (!same_bytes(geometry.vertices[a], geometry.vertices[b])) {
+            return false;
+        }
+        if (has_normals && !same_bytes(geometry.normals[a], geometry.normals[b])) {
+            return false;
+        }
+        for (auto& tex_coordinate_set : geometry.tex_coordinate_sets) {
+            if (!same_bytes(tex_coordinate_set[a], tex_coordinate_set[b])) {
+                return false;
+            }
+        }
+        if (has_skin && (!same_bytes(geometry.skeleton.weights[a], geometry.skeleton.weights[b]) || !same_bytes(geometry.skeleton.bone_indices[a], geometry.skeleton.bone_indices[b]))) {
+            return false;
+        }
+        for (size_t t = 0; t < morph_entries.size(); t++) {
+            const int16_t* delta_a = get_morph_delta(t, a);
+            const int16_t* delta_b = get_morph_delta(t, b);
+            if ((delta_a == nullptr) != (delta_b == nullptr) || (delta_a && std::memcmp(delta_a, delta_b, 3 * sizeof(int16_t)) != 0)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // open addressing table of first occurrences
+    size_t table_size = 1;
+    while (table_size < num_vertices * 2) {
+        table_size <<= 1;
+    }
+    std::vector<uint32_t> table(table_size, invalid_index);
+
+    std::vector<uint32_t> remap(num_vertices);
+    uint32_t num_unique_vertices = 0;
+    for (size_t i = 0; i < num_vertices; i++) {
+        size_t slot = hash_vertex(i) & (table_size - 1);
+        while (table[slot] != invalid_index && !same_vertex(table[slot], i)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (table[slot] == invalid_index) {
+            table[slot] = static_cast<uint32_t>(i);
+            remap[i] = num_unique_vertices++;
+        } else {
+            remap[i] = remap[table[slot]];
+        }
+    }
+
+    if (num_unique_vertices == num_vertices) {
+        return;
+    }
+
+    apply_vertex_remap(geometry, remap, num_unique_vertices);
+}
+
+float vertex_score(int32_t cache_position, uint32_t num_remaining_triangles)
+{
+    if (num_remaining_triangles == 0) {
+        return -1.f;
+    }
+
+    float score = 0.f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // the last triangle's vertices get a fixed score so the next triangle doesn't always reuse them
+            score = 0.75f;
+        } else {
+            const float scaler = 1.f / (vertex_cache_size - 3);
+            score = std::pow(1.f - (cache_position - 3) * scaler, 1.5f);
+        }
+    }
+
+    // favour vertices with few triangles left so they can leave the cache for good
+    return score + 2.f / std::sqrt(static_cast<float>(num_remaining_triangles));
+}
+
+void gta_to_ue::optimize::optimize_vertex_cache(Geometry& geometry)
+{
+    const size_t num_triangles = geometry.get_num_triangles();
+    const size_t num_vertices = geometry.vertices.size();
+    if (num_triangles == 0) {
+        return;
+    }
+
+    // vertex -> triangles adjacency
+    std::vector<uint32_t> adjacency_offsets(num_vertices + 1, 0);
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        adjacency_offsets[geometry.indices[i] + 1]++;
+    }
+    for (size_t i = 0; i < num_vertices; i++) {
+        adjacency_offsets[i + 1] += adjacency_offsets[i];
+    }
+    std::vector<uint32_t> adjacency(geometry.indices.size());
+    std::vector<uint32_t> num_remaining_triangles(num_vertices, 0);
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        const uint32_t vertex = geometry.indices[i];
+        adjacency[adjacency_offsets[vertex] + num_remaining_triangles[vertex]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cache_positions(num_vertices, -1);
+    std::vector<float> vertex_scores(num_vertices);
+    for (size_t i = 0; i < num_vertices; i++) {
+        vertex_scores[i] = vertex_score(-1, num_remaining_triangles[i]);
+    }
+
+    std::vector<float> triangle_scores(num_triangles);
+    for (size_t i = 0; i < num_triangles; i++) {
+        triangle_scores[i] = vertex_scores[geometry.indices[i * 3]] + vertex_scores[geometry.indices[i * 3 + 1]] + vertex_scores[geometry.indices[i * 3 + 2]];
+    }
+
+    std::vector<bool> emitted(num_triangles, false);
+    std::vector<uint32_t> triangle_order;
+    triangle_order.reserve(num_triangles);
+
+    // one extra slot for the vertices pushed out by the last triangle
+    std::vector<uint32_t> cache;
+    cache.reserve(vertex_cache_size + 3);
+    std::vector<uint32_t> new_cache;
+    new_cache.reserve(vertex_cache_size + 3);
+
+    size_t search_cursor = 0;
+    uint32_t best_triangle = invalid_index;
+    while (triangle_order.size() < num_triangles) {
+        if (best_triangle == invalid_index) {
+            // nothing adjacent to the cache is left, fall back to the best remaining triangle
+            float best_score = -1.f;
+            for (size_t i = search_cursor; i < num_triangles; i++) {
+                if (!emitted[i] && triangle_scores[i] > best_score) {
+                    best_score = triangle_scores[i];
+                    best_triangle = static_cast<uint32_t>(i);
+                }
+            }
+            while (search_cursor < num_triangles && emitted[search_cursor]) {
+                search_cursor++;
+            }
+        }
+
+        emitted[best_triangle] = true;
+        triangle_order.push_back(best_triangle);
+
+        new_cache.clear();
+        for (int32_t i = 0; i < 3; i++) {
+            const uint32_t vertex = geometry.indices[best_triangle * 3 + i];
+            new_cache.push_back(vertex);
+
+            // drop the triangle from the vertex's remaining list
+            const uint32_t begin = adjacency_offsets[vertex];
+            const uint32_t end = begin + num_remaining_triangles[vertex];
+            for (uint32_t j = begin; j < end; j++) {
+                if (adjacency[j] == best_triangle) {
+                    adjacency[j] = adjacency[end - 1];
+                    break;
+                }
+            }
+            num_remaining_triangles[vertex]--;
+        }
+        for (const uint32_t vertex : cache) {
+            if (vertex != new_cache[0] && vertex != new_cache[1] && vertex != new_cache[2]) {
+                new_cache.push_back(vertex);
+            }
+        }
+        std::swap(cache, new_cache);
+
+        for (size_t i = vertex_cache_size; i < cache.size(); i++) {
+            cache_positions[cache[i]] = -1;
+            vertex_scores[cache[i]] = vertex_score(-1, num_remaining_triangles[cache[i]]);
+        }
+        if (cache.size() > vertex_cache_size) {
+            cache.resize(vertex_cache_size);
+        }
+
+        for (size_t i = 0; i < cache.size(); i++) {
+            cache_positions[cache[i]] = static_cast<int32_t>(i);
+            vertex_scores[cache[i]] = vertex_score(static_cast<int32_t>(i), num_remaining_triangles[cache[i]]);
+        }
+
+        // rescore the triangles around the cache and pick the next one among them
+        best_triangle = invalid_index;
+        float best_score = -1.f;
+        for (const uint32_t vertex : cache) {
+            const uint32_t begin = adjacency_offsets[vertex];
+            const uint32_t end = begin + num_remaining_triangles[vertex];
+            for (uint32_t j = begin; j < end; j++) {
+                const uint32_t triangle = adjacency[j];
+                const float score = vertex_scores[geometry.indices[triangle * 3]] + vertex_scores[geometry.indices[triangle * 3 + 1]] + vertex_scores[geometry.indices[triangle * 3 + 2]];
+                triangle_scores[triangle] = score;
+                if (score > best_score) {
+                    best_score = score;
+                    best_triangle = triangle;
+                }
+            }
+        }
+    }
+
+    IndexBuffer indices;
+    indices.reset(num_vertices);
+    indices.reserve(geometry.indices.size());
+    std::vector<int32_t> material_ids;
+    material_ids.reserve(num_triangles);
+    for (const uint32_t triangle : triangle_order) {
+        indices.push_back(geometry.indices[triangle * 3]);
+        indices.push_back(geometry.indices[triangle * 3 + 1]);
+        indices.push_back(geometry.indices[triangle * 3 + 2]);
+        material_ids.push_back(geometry.material_ids[triangle]);
+    }
+    geometry.indices = std::move(indices);
+    geometry.material_ids = std::move(material_ids);
+}
+
+void gta_to_ue::optimize::optimize_vertex_fetch(Geometry& geometry)
+{
+    std::vector<uint32_t> remap(geometry.vertices.size(), invalid_index);
+    uint32_t num_new_vertices = 0;
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        if (remap[geometry.indices[i]] == invalid_index) {
+            remap[geometry.indices[i]] = num_new_vertices++;
+        }
+    }
+
+    apply_vertex_remap(geometry, remap, num_new_vertices);
+}
+
+size_t gta_to_ue::optimize::count_cache_misses(const Geometry& geometry, uint32_t cache_size)
+{
+    std::vector<uint32_t> cache(cache_size, invalid_index);
+    size_t cache_head = 0;
+    size_t num_misses = 0;
+
+    for (size_t i = 0; i < geometry.indices.size(); i++) {
+        const uint32_t vertex = geometry.indices[i];
+        if (std::find(cache.begin(), cache.end(), vertex) != cache.end()) {
+            continue;
+        }
+        cache[cache_head] = vertex;
+        cache_head = (cache_head + 1) % cache_size;
+        num_misses++;
+    }
+
+    return num_misses;
+}
+
+float gta_to_ue::optimize::Stats::get_acmr_before() const
+{
+    return num_triangles > 0 ? static_cast<float>(cache_misses_before) / num_triangles : 0.f;
+}
+
+float gta_to_ue::optimize::Stats::get_acmr_after() const
+{
+    return num_triangles > 0 ? static_cast<float>(cache_misses_after) / num_triangles : 0.f;
+}
+
+gta_to_ue::optimize::Stats gta_to_ue::optimize::optimize_mesh(Mesh& mesh)
+{
+    Stats stats;
+    for (auto& geometry : mesh.geometries) {
+        stats.num_vertices_before += geometry.vertices.size();
+        stats.num_triangles += geometry.get_num_triangles();
+        stats.cache_misses_before += count_cache_misses(geometry);
+
+        weld_vertices(geometry);
+        optimize_vertex_cache(geometry);
+        optimize_vertex_fetch(geometry);
+
+        stats.num_vertices_after += geometry.vertices.size();
+        stats.cache_misses_after += count_cache_misses(geometry);
+    }
+
+    return stats;
+}
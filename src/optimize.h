@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace optimize {
+        struct Stats
+        {
+            size_t num_vertices_before{ 0 };
+            size_t num_vertices_after{ 0 };
+            size_t num_triangles{ 0 };
+            size_t cache_misses_before{ 0 };
+            size_t cache_misses_after{ 0 };
+
+            float get_acmr_before() const;
+            float get_acmr_after() const;
+        };
+
+        // merges vertices with identical position, normal, uv and skin attributes
+        void weld_vertices(gta_to_ue::Geometry& geometry);
+
+        // reorders triangles for the post-transform vertex cache (Forsyth)
+        void optimize_vertex_cache(gta_to_ue::Geometry& geometry);
+
+        // reorders vertices by first use in the index buffer and drops unreferenced ones
+        void optimize_vertex_fetch(gta_to_ue::Geometry& geometry);
+
+        // number of vertex transforms with a FIFO cache of the given size
+        size_t count_cache_misses(const gta_to_ue::Geometry& geometry, uint32_t cache_size = 32);
+
+        Stats optimize_mesh(gta_to_ue::Mesh& mesh);
+    }
+}
@@ -0,0 +1,175 @@
+#include "output_stream.h"
+#include "profile.h"
+
+#include <cstring>
+#include <zstd.h>
+
+using namespace gta_to_ue;
+
+OutputStream::OutputStream(size_t buffer_size) : buffer(buffer_size), current(buffer.data())
+{}
+
+void OutputStream::Flush()
+{
+    const size_t size = current - buffer.data();
+    current = buffer.data();
+    if (size > 0 && !failed && !write_to_sink(buffer.data(), size)) {
+        failed = true;
+    }
+}
+
+void OutputStream::write(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const size_t available = buffer.data() + buffer.size() - current;
+        if (available == 0) {
+            Flush();
+            continue;
+        }
+
+        if (current == buffer.data() && size >= buffer.size()) {
+            if (!failed && !write_to_sink(bytes, size)) {
+                failed = true;
+            }
+            return;
+        }
+
+        const size_t chunk_size = size < available ? size : available;
+        std::memcpy(current, bytes, chunk_size);
+        current += chunk_size;
+        bytes += chunk_size;
+        size -= chunk_size;
+    }
+}
+
+bool OutputStream::good() const
+{
+    return !failed;
+}
+
+FileOutputStream::~FileOutputStream()
+{
+    close();
+}
+
+bool FileOutputStream::open(const std::string& file_name)
+{
+    close();
+    failed = false;
+    file = std::fopen(file_name.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    // the stream is already buffered, skip the stdio copy
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    return true;
+}
+
+bool FileOutputStream::close()
+{
+    if (!file) {
+        return good();
+    }
+
+    Flush();
+    if (std::fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+
+    return good();
+}
+
+bool FileOutputStream::write_to_sink(const char* data, size_t size)
+{
+    const profile::ScopedTimer timer(profile::Stage::file_write);
+    profile::add(profile::Counter::bytes_written, size);
+    return file && std::fwrite(data, 1, size, file) == size;
+}
+
+ZstdFileOutputStream::ZstdFileOutputStream(int32_t in_level) : level(in_level), compressed(ZSTD_CStreamOutSize())
+{}
+
+ZstdFileOutputStream::~ZstdFileOutputStream()
+{
+    close();
+    ZSTD_freeCCtx(context);
+}
+
+bool ZstdFileOutputStream::open(const std::string& file_name)
+{
+    if (!context) {
+        context = ZSTD_createCCtx();
+    }
+    if (!context || !FileOutputStream::open(file_name)) {
+        return false;
+    }
+
+    ZSTD_CCtx_reset(context, ZSTD_reset_session_only);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(context, ZSTD_c_checksumFlag, 1);
+    is_open = true;
+    return true;
+}
+
+bool ZstdFileOutputStream::close()
+{
+    if (is_open) {
+        is_open = false;
+        Flush();
+        if (!failed && !compress(nullptr, 0, true)) {
+            failed = true;
+        }
+    }
+
+    return FileOutputStream::close();
+}
+
+bool ZstdFileOutputStream::write_to_sink(const char* data, size_t size)
+{
+    return compress(data, size, false);
+}
+
+bool ZstdFileOutputStream::compress(const char* data, size_t size, bool end_frame)
+{
+    ZSTD_inBuffer input{ data, size, 0 };
+    while (true) {
+        ZSTD_outBuffer output{ compressed.data(), compressed.size(), 0 };
+        const size_t remaining = ZSTD_compressStream2(context, &output, &input, end_frame ? ZSTD_e_end : ZSTD_e_continue);
+        if (ZSTD_isError(remaining)) {
+            return false;
+        }
+        if (output.pos > 0 && !FileOutputStream::write_to_sink(compressed.data(), output.pos)) {
+            return false;
+        }
+        // continue is done once the input is consumed, end once the frame is flushed
+        if (end_frame ? remaining == 0 : input.pos == input.size) {
+            return true;
+        }
+    }
+}
+
+std::unique_ptr<FileOutputStream> gta_to_ue::create_file_output_stream(const ExportOptions& export_options)
+{
+    if (export_options.compression == Compression::zstd) {
+        return std::make_unique<ZstdFileOutputStream>(export_options.compression_level);
+    }
+    return std::make_unique<FileOutputStream>();
+}
+
+MemoryOutputStream::MemoryOutputStream(size_t buffer_size) : OutputStream(buffer_size)
+{}
+
+const std::vector<char>& MemoryOutputStream::get_data()
+{
+    Flush();
+    return data;
+}
+
+bool MemoryOutputStream::write_to_sink(const char* in_data, size_t size)
+{
+    data.insert(data.end(), in_data, in_data + size);
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+
+namespace gta_to_ue {
+
+    // buffered byte sink usable as a rapidjson output stream, the buffer is drained into the sink when it fills up
+    class OutputStream
+    {
+    public:
+        typedef char Ch;
+
+        explicit OutputStream(size_t buffer_size = 64 * 1024);
+        virtual ~OutputStream() = default;
+
+        OutputStream(const OutputStream&) = delete;
+        OutputStream& operator = (const OutputStream&) = delete;
+
+        void Put(Ch c)
+        {
+            if (current == buffer.data() + buffer.size()) {
+                Flush();
+            }
+            *current++ = c;
+        }
+
+        void Flush();
+
+        void write(const void* data, size_t size);
+
+        bool good() const;
+
+    protected:
+        virtual bool write_to_sink(const char* data, size_t size) = 0;
+
+        bool failed{ false };
+
+    private:
+        std::vector<char> buffer;
+        char* current;
+    };
+
+    class FileOutputStream: public OutputStream
+    {
+    public:
+        FileOutputStream() = default;
+        ~FileOutputStream() override;
+
+        virtual bool open(const std::string& file_name);
+        virtual bool close();
+
+    protected:
+        bool write_to_sink(const char* data, size_t size) override;
+
+    private:
+        FILE* file{ nullptr };
+    };
+
+    // zstd frame written chunk by chunk, every filled buffer is compressed and written out right away
+    class ZstdFileOutputStream: public FileOutputStream
+    {
+    public:
+        explicit ZstdFileOutputStream(int32_t in_level);
+        ~ZstdFileOutputStream() override;
+
+        bool open(const std::string& file_name) override;
+        // ends the frame, a file that isn't closed has no valid frame
+        bool close() override;
+
+    protected:
+        bool write_to_sink(const char* data, size_t size) override;
+
+    private:
+        bool compress(const char* data, size_t size, bool end_frame);
+
+        ZSTD_CCtx* context{ nullptr };
+        int32_t level;
+        std::vector<char> compressed;
+        bool is_open{ false };
+    };
+
+    // the output file of an exporter, compressed if the export options ask for it
+    std::unique_ptr<FileOutputStream> create_file_output_stream(const ExportOptions& export_options);
+
+    // keeps everything written in memory, e.g. a part of a file serialized on another thread
+    class MemoryOutputStream: public OutputStream
+    {
+    public:
+        explicit MemoryOutputStream(size_t buffer_size = 16 * 1024);
+
+        // flushes the buffer, the data holds everything written so far
+        const std::vector<char>& get_data();
+
+    protected:
+        bool write_to_sink(const char* data, size_t size) override;
+
+    private:
+        std::vector<char> data;
+    };
+}
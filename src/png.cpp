@@ -0,0 +1,293 @@
+#include "png.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+
+constexpr size_t window_size = 32768;
+constexpr size_t min_match = 3;
+constexpr size_t max_match = 258;
+constexpr int32_t hash_bits = 15;
+constexpr int32_t max_chain = 32;
+
+constexpr uint16_t length_bases[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+constexpr uint8_t length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+constexpr uint16_t distance_bases[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+constexpr uint8_t distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& in_data) : data(in_data)
+    {}
+
+    // deflate packs values from the least significant bit on
+    void write(uint32_t value, int32_t num_bits)
+    {
+        buffer |= static_cast<uint64_t>(value) << num_buffered_bits;
+        num_buffered_bits += num_bits;
+        while (num_buffered_bits >= 8) {
+            data.push_back(static_cast<uint8_t>(buffer));
+            buffer >>= 8;
+            num_buffered_bits -= 8;
+        }
+    }
+
+    // huffman codes are stored starting with their most significant bit
+    void write_code(uint32_t code, int32_t num_bits)
+    {
+        uint32_t reversed = 0;
+        for (int32_t i = 0; i < num_bits; i++) {
+            reversed |= ((code >> i) & 1) << (num_bits - 1 - i);
+        }
+        write(reversed, num_bits);
+    }
+
+    void flush()
+    {
+        if (num_buffered_bits > 0) {
+            data.push_back(static_cast<uint8_t>(buffer));
+        }
+        buffer = 0;
+        num_buffered_bits = 0;
+    }
+
+private:
+    std::vector<uint8_t>& data;
+    uint64_t buffer{ 0 };
+    int32_t num_buffered_bits{ 0 };
+};
+
+void write_literal(BitWriter& writer, uint32_t symbol)
+{
+    if (symbol < 144) {
+        writer.write_code(0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        writer.write_code(0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        writer.write_code(symbol - 256, 7);
+    } else {
+        writer.write_code(0xC0 + symbol - 280, 8);
+    }
+}
+
+void write_match(BitWriter& writer, size_t length, size_t distance)
+{
+    int32_t length_code = 28;
+    while (length_bases[length_code] > length) {
+        length_code--;
+    }
+    write_literal(writer, 257 + length_code);
+    writer.write(static_cast<uint32_t>(length - length_bases[length_code]), length_extra_bits[length_code]);
+
+    int32_t distance_code = 29;
+    while (distance_bases[distance_code] > distance) {
+        distance_code--;
+    }
+    writer.write_code(distance_code, 5);
+    writer.write(static_cast<uint32_t>(distance - distance_bases[distance_code]), distance_extra_bits[distance_code]);
+}
+
+uint32_t get_hash(const uint8_t* data)
+{
+    const uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+uint32_t get_crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> values{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t value = i;
+            for (int32_t j = 0; j < 8; j++) {
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            values[i] = value;
+        }
+        return values;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t get_adler32(const uint8_t* data, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0) {
+        // the sums fit 32 bits for 5552 bytes before the modulo
+        const size_t chunk_size = size < 5552 ? size : 5552;
+        for (size_t i = 0; i < chunk_size; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += chunk_size;
+        size -= chunk_size;
+    }
+    return (b << 16) | a;
+}
+
+void write_u32_be(std::vector<uint8_t>& data, uint32_t value)
+{
+    data.push_back(static_cast<uint8_t>(value >> 24));
+    data.push_back(static_cast<uint8_t>(value >> 16));
+    data.push_back(static_cast<uint8_t>(value >> 8));
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+void write_chunk(std::vector<uint8_t>& encoded, const char* type, const std::vector<uint8_t>& chunk_data)
+{
+    write_u32_be(encoded, static_cast<uint32_t>(chunk_data.size()));
+    const size_t type_offset = encoded.size();
+    encoded.insert(encoded.end(), type, type + 4);
+    encoded.insert(encoded.end(), chunk_data.begin(), chunk_data.end());
+    write_u32_be(encoded, get_crc32(encoded.data() + type_offset, encoded.size() - type_offset));
+}
+
+uint8_t get_paeth(int32_t left, int32_t up, int32_t up_left)
+{
+    const int32_t estimate = left + up - up_left;
+    const int32_t left_distance = std::abs(estimate - left);
+    const int32_t up_distance = std::abs(estimate - up);
+    const int32_t up_left_distance = std::abs(estimate - up_left);
+    if (left_distance <= up_distance && left_distance <= up_left_distance) {
+        return static_cast<uint8_t>(left);
+    }
+    return static_cast<uint8_t>(up_distance <= up_left_distance ? up : up_left);
+}
+
+void gta_to_ue::png::deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+{
+    // zlib header: deflate with a 32 KiB window, fastest compression level
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+
+    BitWriter writer(compressed);
+    writer.write(1, 1);
+    writer.write(1, 2);
+
+    std::vector<int32_t> head(size_t(1) << hash_bits, -1);
+    std::vector<int32_t> previous(window_size, -1);
+    auto insert = [&](size_t position) {
+        const uint32_t hash = get_hash(data + position);
+        previous[position % window_size] = head[hash];
+        head[hash] = static_cast<int32_t>(position);
+    };
+
+    size_t position = 0;
+    while (position < size) {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+        if (position + min_match <= size) {
+            const size_t max_length = size - position < max_match ? size - position : max_match;
+            int32_t candidate = head[get_hash(data + position)];
+            for (int32_t chain = 0; chain < max_chain && candidate >= 0 && position - candidate <= window_size; chain++) {
+                size_t length = 0;
+                while (length < max_length && data[candidate + length] == data[position + length]) {
+                    length++;
+                }
+                if (length > best_length) {
+                    best_length = length;
+                    best_distance = position - candidate;
+                    if (length == max_length) {
+                        break;
+                    }
+                }
+                const int32_t next = previous[candidate % window_size];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+
+        if (best_length >= min_match) {
+            write_match(writer, best_length, best_distance);
+            for (size_t i = 0; i < best_length; i++, position++) {
+                if (position + min_match <= size) {
+                    insert(position);
+                }
+            }
+        } else {
+            write_literal(writer, data[position]);
+            if (position + min_match <= size) {
+                insert(position);
+            }
+            position++;
+        }
+    }
+
+    write_literal(writer, 256);
+    writer.flush();
+    write_u32_be(compressed, get_adler32(data, size));
+}
+
+void gta_to_ue::png::encode(const uint8_t* pixels, int32_t width, int32_t height, int32_t num_channels, std::vector<uint8_t>& encoded)
+{
+    const size_t row_size = static_cast<size_t>(width) * num_channels;
+
+    // a filter type byte in front of every row: none, sub, up or paeth
+    std::vector<uint8_t> filtered((row_size + 1) * height);
+    std::vector<uint8_t> candidates[4];
+    for (auto& candidate : candidates) {
+        candidate.resize(row_size);
+    }
+    for (int32_t y = 0; y < height; y++) {
+        const uint8_t* row = pixels + y * row_size;
+        const uint8_t* previous_row = y > 0 ? row - row_size : nullptr;
+
+        int32_t best_filter = 0;
+        uint64_t best_cost = UINT64_MAX;
+        for (int32_t filter = 0; filter < 4; filter++) {
+            uint64_t cost = 0;
+            for (size_t i = 0; i < row_size; i++) {
+                const int32_t left = i >= static_cast<size_t>(num_channels) ? row[i - num_channels] : 0;
+                const int32_t up = previous_row ? previous_row[i] : 0;
+                const int32_t up_left = previous_row && i >= static_cast<size_t>(num_channels) ? previous_row[i - num_channels] : 0;
+                uint8_t value = row[i];
+                if (filter == 1) {
+                    value = static_cast<uint8_t>(value - left);
+                } else if (filter == 2) {
+                    value = static_cast<uint8_t>(value - up);
+                } else if (filter == 3) {
+                    value = static_cast<uint8_t>(value - get_paeth(left, up, up_left));
+                }
+                candidates[filter][i] = value;
+                cost += value < 128 ? value : 256 - value;
+            }
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_filter = filter;
+            }
+        }
+
+        uint8_t* out = filtered.data() + y * (row_size + 1);
+        out[0] = static_cast<uint8_t>(best_filter == 3 ? 4 : best_filter);
+        std::memcpy(out + 1, candidates[best_filter].data(), row_size);
+    }
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    encoded.assign(signature, signature + 8);
+
+    std::vector<uint8_t> header;
+    write_u32_be(header, static_cast<uint32_t>(width));
+    write_u32_be(header, static_cast<uint32_t>(height));
+    header.push_back(8);
+    header.push_back(num_channels == 4 ? 6 : 2);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    write_chunk(encoded, "IHDR", header);
+
+    std::vector<uint8_t> compressed;
+    deflate(filtered.data(), filtered.size(), compressed);
+    write_chunk(encoded, "IDAT", compressed);
+    write_chunk(encoded, "IEND", {});
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gta_to_ue {
+    namespace png {
+        // zlib stream of a single fixed huffman deflate block with greedy lz77 matches, no dependency for the few textures of a model
+        void deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+
+        // 8-bit rgb (3 channels) or rgba (4 channels) png file bytes, every row gets the filter with the smallest sum of absolute values
+        void encode(const uint8_t* pixels, int32_t width, int32_t height, int32_t num_channels, std::vector<uint8_t>& encoded);
+    }
+}
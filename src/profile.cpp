@@ -0,0 +1,200 @@
+#include "profile.h"
+#include "output_stream.h"
+
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <rapidjson/writer.h>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t num_stages = static_cast<size_t>(gta_to_ue::profile::Stage::count);
+constexpr size_t num_counters = static_cast<size_t>(gta_to_ue::profile::Counter::count);
+
+constexpr const char* stage_names[num_stages] = {
+    "file",
+    "read_clump",
+    "parse_rw_frames",
+    "parse_rw_materials",
+    "parse_rw_geometry",
+    "parse_rw_skin_data",
+    "mixin_car_wheel",
+    "build_car",
+    "generate_lods",
+    "optimize_mesh",
+    "export",
+    "extract_texture",
+    "file write"
+};
+
+constexpr const char* counter_names[num_counters] = {
+    "files",
+    "bytes read",
+    "frames",
+    "materials",
+    "geometries",
+    "vertices",
+    "triangles",
+    "bytes written"
+};
+
+struct StageStats
+{
+    std::atomic<uint64_t> calls{ 0 };
+    std::atomic<uint64_t> total_ns{ 0 };
+    std::atomic<uint64_t> max_ns{ 0 };
+};
+
+struct TraceEvent
+{
+    gta_to_ue::profile::Stage stage;
+    std::string label;
+    int64_t begin_ns;
+    int64_t duration_ns;
+    uint32_t thread_id;
+};
+
+std::atomic<bool> profile_enabled{ false };
+bool trace_enabled = false;
+Clock::time_point profile_start;
+StageStats stage_stats[num_stages];
+std::atomic<uint64_t> counters[num_counters];
+
+std::mutex trace_mutex;
+std::vector<TraceEvent> trace_events;
+std::atomic<uint32_t> num_threads{ 0 };
+
+uint32_t get_thread_id()
+{
+    thread_local const uint32_t thread_id = num_threads++;
+    return thread_id;
+}
+
+void gta_to_ue::profile::enable(bool record_trace)
+{
+    trace_enabled = record_trace;
+    profile_start = Clock::now();
+    profile_enabled = true;
+}
+
+bool gta_to_ue::profile::is_enabled()
+{
+    return profile_enabled.load(std::memory_order_relaxed);
+}
+
+void gta_to_ue::profile::add(Counter counter, uint64_t value)
+{
+    if (is_enabled()) {
+        counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+gta_to_ue::profile::ScopedTimer::ScopedTimer(Stage in_stage, const std::string& in_label) : stage(in_stage), active(is_enabled())
+{
+    if (!active) {
+        return;
+    }
+    if (trace_enabled) {
+        label = in_label;
+    }
+    begin = Clock::now();
+}
+
+gta_to_ue::profile::ScopedTimer::~ScopedTimer()
+{
+    if (!active) {
+        return;
+    }
+
+    const Clock::time_point end = Clock::now();
+    const uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+
+    StageStats& stats = stage_stats[static_cast<size_t>(stage)];
+    stats.calls.fetch_add(1, std::memory_order_relaxed);
+    stats.total_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+    uint64_t max_ns = stats.max_ns.load(std::memory_order_relaxed);
+    while (duration_ns > max_ns && !stats.max_ns.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed)) {
+    }
+
+    if (trace_enabled) {
+        TraceEvent event{ stage, std::move(label), std::chrono::duration_cast<std::chrono::nanoseconds>(begin - profile_start).count(), static_cast<int64_t>(duration_ns), get_thread_id() };
+        std::lock_guard lock(trace_mutex);
+        trace_events.push_back(std::move(event));
+    }
+}
+
+void gta_to_ue::profile::print_summary(std::ostream& stream)
+{
+    std::ostringstream s;
+    char line[128];
+
+    std::snprintf(line, sizeof(line), "%-20s %10s %12s %10s %10s\n", "stage", "calls", "total ms", "avg ms", "max ms");
+    s << line;
+    for (size_t i = 0; i < num_stages; i++) {
+        const uint64_t calls = stage_stats[i].calls;
+        if (calls == 0) {
+            continue;
+        }
+        const double total_ms = stage_stats[i].total_ns / 1e6;
+        std::snprintf(line, sizeof(line), "%-20s %10llu %12.3f %10.3f %10.3f\n", stage_names[i], static_cast<unsigned long long>(calls),
+            total_ms, total_ms / calls, stage_stats[i].max_ns / 1e6);
+        s << line;
+    }
+
+    s << "\n";
+    for (size_t i = 0; i < num_counters; i++) {
+        std::snprintf(line, sizeof(line), "%-20s %10llu\n", counter_names[i], static_cast<unsigned long long>(counters[i].load()));
+        s << line;
+    }
+
+    stream << s.str() << std::flush;
+}
+
+bool gta_to_ue::profile::write_trace(const std::string& file_name)
+{
+    // copied first, writing the trace adds file write spans of its own
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard lock(trace_mutex);
+        events = trace_events;
+    }
+
+    gta_to_ue::FileOutputStream ofs;
+    if (!ofs.open(file_name)) {
+        return false;
+    }
+
+    rapidjson::Writer<gta_to_ue::OutputStream> writer(ofs);
+    writer.StartObject();
+    writer.Key("displayTimeUnit");
+    writer.String("ms");
+    writer.Key("traceEvents");
+    writer.StartArray();
+    for (const auto& event : events) {
+        writer.StartObject();
+        writer.Key("name");
+        if (event.label.empty()) {
+            writer.String(stage_names[static_cast<size_t>(event.stage)]);
+        } else {
+            writer.String(event.label.c_str(), static_cast<rapidjson::SizeType>(event.label.size()));
+        }
+        writer.Key("cat");
+        writer.String(stage_names[static_cast<size_t>(event.stage)]);
+        writer.Key("ph");
+        writer.String("X");
+        writer.Key("ts");
+        writer.Double(event.begin_ns / 1e3);
+        writer.Key("dur");
+        writer.Double(event.duration_ns / 1e3);
+        writer.Key("pid");
+        writer.Int(1);
+        writer.Key("tid");
+        writer.Uint(event.thread_id);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    return ofs.close();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace gta_to_ue {
+    namespace profile {
+        enum class Stage
+        {
+            file,
+            read_clump,
+            parse_frames,
+            parse_materials,
+            parse_geometry,
+            parse_skin,
+            car_wheels,
+            build_car,
+            lods,
+            optimize,
+            export_mesh,
+            extract_texture,
+            file_write,
+            count
+        };
+
+        enum class Counter
+        {
+            files,
+            bytes_read,
+            frames,
+            materials,
+            geometries,
+            vertices,
+            triangles,
+            bytes_written,
+            count
+        };
+
+        // profiling is off until enabled, the timers and counters then cost a clock read and a few atomics
+        void enable(bool record_trace);
+        bool is_enabled();
+
+        void add(Counter counter, uint64_t value);
+
+        // stage times are inclusive, e.g. parse_geometry contains parse_materials and parse_skin
+        void print_summary(std::ostream& stream);
+
+        // chrome trace event json (chrome://tracing, perfetto), one span per stage and file on the thread that ran it
+        bool write_trace(const std::string& file_name);
+
+        class ScopedTimer
+        {
+        public:
+            // the label names the span in the trace, e.g. the input file of a file span
+            explicit ScopedTimer(Stage in_stage, const std::string& in_label = std::string());
+            ~ScopedTimer();
+
+            ScopedTimer(const ScopedTimer&) = delete;
+            ScopedTimer& operator = (const ScopedTimer&) = delete;
+
+        private:
+            Stage stage;
+            std::string label;
+            std::chrono::steady_clock::time_point begin;
+            bool active;
+        };
+    }
+}
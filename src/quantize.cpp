@@ -0,0 +1,84 @@
+#include "quantize.h"
+
+#include <algorithm>
+#include <cmath>
+
+gta_to_ue::quantize::Range gta_to_ue::quantize::get_range(const std::vector<float>& values)
+{
+    if (values.empty()) {
+        return Range{ 0.f, 0.f };
+    }
+
+    const auto [min, max] = std::minmax_element(values.begin(), values.end());
+    return Range{ *min, *max };
+}
+
+void gta_to_ue::quantize::encode_unorm16(const std::vector<float>& values, const Range& range, std::vector<uint16_t>& encoded)
+{
+    const float extent = range.max - range.min;
+    const float scale = extent > 0.f ? 65535.f / extent : 0.f;
+    encoded.resize(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        encoded[i] = static_cast<uint16_t>(std::clamp(std::round((values[i] - range.min) * scale), 0.f, 65535.f));
+    }
+}
+
+float sign_not_zero(float value)
+{
+    return value >= 0.f ? 1.f : -1.f;
+}
+
+gta_to_ue::Vector2f gta_to_ue::quantize::octahedral_encode(const Vector3f& normal)
+{
+    const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (length == 0.f) {
+        return Vector2f(0.f, 0.f);
+    }
+
+    const float x = normal.x / length;
+    const float y = normal.y / length;
+    if (normal.z >= 0.f) {
+        return Vector2f(x, y);
+    }
+    // the lower hemisphere is folded over the diagonals
+    return Vector2f((1.f - std::abs(y)) * sign_not_zero(x), (1.f - std::abs(x)) * sign_not_zero(y));
+}
+
+template <typename T>
+void encode_snorm_normals(const gta_to_ue::Vector3Stream& normals, std::vector<uint8_t>& encoded)
+{
+    constexpr float max_value = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+    encoded.resize(normals.size() * 2 * sizeof(T));
+    T* out = reinterpret_cast<T*>(encoded.data());
+    for (size_t i = 0; i < normals.size(); i++) {
+        const gta_to_ue::Vector2f octahedral = gta_to_ue::quantize::octahedral_encode(normals[i]);
+        out[i * 2] = static_cast<T>(std::round(std::clamp(octahedral.x, -1.f, 1.f) * max_value));
+        out[i * 2 + 1] = static_cast<T>(std::round(std::clamp(octahedral.y, -1.f, 1.f) * max_value));
+    }
+}
+
+void gta_to_ue::quantize::encode_normals(const Vector3Stream& normals, int32_t bits, std::vector<uint8_t>& encoded)
+{
+    if (bits == 8) {
+        encode_snorm_normals<int8_t>(normals, encoded);
+    } else {
+        encode_snorm_normals<int16_t>(normals, encoded);
+    }
+}
+
+void gta_to_ue::quantize::encode_indices(const IndexBuffer& indices, std::vector<uint8_t>& encoded)
+{
+    encoded.clear();
+    encoded.reserve(indices.size() * 2);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        const int32_t delta = static_cast<int32_t>(indices[i] - previous);
+        uint32_t value = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        previous = indices[i];
+        while (value >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(value));
+    }
+}
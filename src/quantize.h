@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace quantize {
+        struct Range
+        {
+            float min;
+            float max;
+        };
+
+        // unorm 16 values of one component inside the range, value = min + q / 65535 * (max - min)
+        Range get_range(const std::vector<float>& values);
+        void encode_unorm16(const std::vector<float>& values, const Range& range, std::vector<uint16_t>& encoded);
+
+        // x and y of the octahedral projection of the unit vector, both in [-1, 1]
+        Vector2f octahedral_encode(const Vector3f& normal);
+
+        // snorm octahedral normals with 8 or 16 bits per component, interleaved x, y
+        void encode_normals(const Vector3Stream& normals, int32_t bits, std::vector<uint8_t>& encoded);
+
+        // every index as the zigzag-encoded difference to the previous one in LEB128 varint bytes
+        void encode_indices(const IndexBuffer& indices, std::vector<uint8_t>& encoded);
+    }
+}
@@ -0,0 +1,427 @@
+#include "serve.h"
+#include "converter.h"
+#include "worker_pool.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#endif
+
+#if !defined(_WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+using Clock = std::chrono::steady_clock;
+using ResponseWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+struct Request
+{
+    std::string id;
+    bool has_id{ false };
+    bool is_number_id{ false };
+    int64_t number_id{ 0 };
+    std::string input_file;
+    std::string output_file;
+    ConvertingOptions converting_options;
+    ExportOptions export_options;
+};
+
+bool read_string(const rapidjson::Value& object, const char* name, std::string& value, std::string& error)
+{
+    const auto member = object.FindMember(name);
+    if (member == object.MemberEnd()) {
+        return true;
+    }
+    if (!member->value.IsString()) {
+        error = std::string(name) + " must be a string";
+        return false;
+    }
+    value.assign(member->value.GetString(), member->value.GetStringLength());
+    return true;
+}
+
+bool read_bool(const rapidjson::Value& object, const char* name, bool& value, std::string& error)
+{
+    const auto member = object.FindMember(name);
+    if (member == object.MemberEnd()) {
+        return true;
+    }
+    if (!member->value.IsBool()) {
+        error = std::string(name) + " must be a bool";
+        return false;
+    }
+    value = member->value.GetBool();
+    return true;
+}
+
+template <typename T>
+bool read_number(const rapidjson::Value& object, const char* name, T& value, std::string& error)
+{
+    const auto member = object.FindMember(name);
+    if (member == object.MemberEnd()) {
+        return true;
+    }
+    if (!member->value.IsNumber()) {
+        error = std::string(name) + " must be a number";
+        return false;
+    }
+    value = static_cast<T>(member->value.GetDouble());
+    return true;
+}
+
+bool parse_request(const std::string& line, const ConvertingOptions& default_converting_options, const ExportOptions& default_export_options, Request& request, std::string& error)
+{
+    rapidjson::Document document;
+    document.Parse(line.c_str(), line.size());
+    if (document.HasParseError() || !document.IsObject()) {
+        error = "request is not a json object";
+        return false;
+    }
+
+    if (const auto id = document.FindMember("id"); id != document.MemberEnd()) {
+        request.has_id = true;
+        if (id->value.IsString()) {
+            request.id.assign(id->value.GetString(), id->value.GetStringLength());
+        } else if (id->value.IsInt64()) {
+            request.is_number_id = true;
+            request.number_id = id->value.GetInt64();
+        } else {
+            error = "id must be a string or an integer";
+            return false;
+        }
+    }
+
+    request.converting_options = default_converting_options;
+    request.export_options = default_export_options;
+    auto& converting_options = request.converting_options;
+
+    std::string format;
+    std::string json_layout;
+    std::string compression;
+    if (!read_string(document, "input", request.input_file, error)
+        || !read_string(document, "output", request.output_file, error)
+        || !read_bool(document, "car", converting_options.is_car, error)
+        || !read_string(document, "wheels", converting_options.wheels_dff, error)
+        || !read_number(document, "wheel_id", converting_options.wheel_id, error)
+        || !read_number(document, "wheel_scale", converting_options.wheel_scale, error)
+        || !read_number(document, "morph_threshold", converting_options.morph_threshold, error)
+        || !read_bool(document, "optimize", converting_options.optimize, error)
+        || !read_string(document, "format", format, error)
+        || !read_string(document, "json_layout", json_layout, error)
+        || !read_string(document, "compress", compression, error)
+        || !read_bool(document, "quantize", request.export_options.quantize, error)
+        || !read_number(document, "normal_bits", request.export_options.normal_bits, error)) {
+        return false;
+    }
+
+    if (const auto lod_ratios = document.FindMember("lod_ratios"); lod_ratios != document.MemberEnd()) {
+        if (!lod_ratios->value.IsArray()) {
+            error = "lod_ratios must be an array";
+            return false;
+        }
+        converting_options.lod_ratios.clear();
+        for (const auto* ratio = lod_ratios->value.Begin(); ratio != lod_ratios->value.End(); ratio++) {
+            if (!ratio->IsNumber()) {
+                error = "lod_ratios must be numbers";
+                return false;
+            }
+            converting_options.lod_ratios.push_back(ratio->GetFloat());
+        }
+    }
+
+    if (format == "bin") {
+        request.export_options.format = OutputFormat::bin;
+    } else if (format == "json") {
+        request.export_options.format = OutputFormat::json;
+    } else if (!format.empty()) {
+        error = "unknown format: " + format;
+        return false;
+    }
+
+    if (json_layout == "compact") {
+        request.export_options.json_layout = JsonLayout::compact;
+    } else if (json_layout == "objects") {
+        request.export_options.json_layout = JsonLayout::objects;
+    } else if (!json_layout.empty()) {
+        error = "unknown json layout: " + json_layout;
+        return false;
+    }
+
+    if (request.export_options.quantize && request.export_options.format != OutputFormat::bin) {
+        error = "quantize needs the bin format";
+        return false;
+    }
+
+    if (request.export_options.normal_bits != 8 && request.export_options.normal_bits != 16) {
+        error = "normal_bits must be 8 or 16";
+        return false;
+    }
+
+    if (!compression.empty() && !gta_to_ue::parse_compression(compression, request.export_options)) {
+        error = "unknown compression: " + compression;
+        return false;
+    }
+
+    if (request.input_file.empty()) {
+        error = "input is missing";
+        return false;
+    }
+
+    if (request.output_file.empty()) {
+        request.output_file = gta_to_ue::get_default_output_file(request.input_file, request.export_options);
+    }
+
+    return true;
+}
+
+double get_milliseconds(Clock::time_point begin, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+void write_id(ResponseWriter& writer, const Request& request)
+{
+    if (!request.has_id) {
+        return;
+    }
+    writer.Key("id");
+    if (request.is_number_id) {
+        writer.Int64(request.number_id);
+    } else {
+        writer.String(request.id.c_str(), static_cast<rapidjson::SizeType>(request.id.size()));
+    }
+}
+
+std::string make_error_response(const Request& request, const std::string& error)
+{
+    rapidjson::StringBuffer buffer;
+    ResponseWriter writer(buffer);
+    writer.StartObject();
+    write_id(writer, request);
+    writer.Key("status");
+    writer.String("bad request");
+    writer.Key("error");
+    writer.String(error.c_str(), static_cast<rapidjson::SizeType>(error.size()));
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string convert_request(const Request& request, Clock::time_point submit_time)
+{
+    const Clock::time_point start_time = Clock::now();
+    const gta_to_ue::ConvertingStatus status = gta_to_ue::convert(request.input_file, request.output_file, request.converting_options, request.export_options);
+    const Clock::time_point end_time = Clock::now();
+
+    rapidjson::StringBuffer buffer;
+    ResponseWriter writer(buffer);
+    writer.StartObject();
+    write_id(writer, request);
+    writer.Key("status");
+    writer.String(gta_to_ue::to_string(status));
+    writer.Key("input");
+    writer.String(request.input_file.c_str(), static_cast<rapidjson::SizeType>(request.input_file.size()));
+    writer.Key("output");
+    writer.String(request.output_file.c_str(), static_cast<rapidjson::SizeType>(request.output_file.size()));
+    writer.Key("queue_ms");
+    writer.Double(get_milliseconds(submit_time, start_time));
+    writer.Key("convert_ms");
+    writer.Double(get_milliseconds(start_time, end_time));
+    writer.EndObject();
+    return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+// parses the request and converts it on the pool, respond is called once with the response line
+void submit_request(gta_to_ue::WorkerPool& pool, const std::string& line, const ConvertingOptions& converting_options, const ExportOptions& export_options, std::function<void(const std::string&)> respond)
+{
+    const Clock::time_point submit_time = Clock::now();
+    auto request = std::make_shared<Request>();
+    std::string error;
+    if (!parse_request(line, converting_options, export_options, *request, error)) {
+        respond(make_error_response(*request, error));
+        return;
+    }
+
+    pool.submit([request, submit_time, respond = std::move(respond)] {
+        respond(convert_request(*request, submit_time));
+    });
+}
+
+bool is_blank(const std::string& line)
+{
+    return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+int32_t gta_to_ue::serve::run_stdin(const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers)
+{
+    // the converter logs to std::cout, stdout is kept for the responses only
+    std::ostream responses(std::cout.rdbuf());
+    std::cout.rdbuf(std::cerr.rdbuf());
+    std::mutex responses_mutex;
+
+    {
+        WorkerPool pool(num_workers);
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (is_blank(line)) {
+                continue;
+            }
+            submit_request(pool, line, converting_options, export_options, [&responses, &responses_mutex](const std::string& response) {
+                std::lock_guard lock(responses_mutex);
+                responses << response << std::endl;
+            });
+        }
+        pool.wait();
+    }
+
+    std::cout.rdbuf(responses.rdbuf());
+    return 0;
+}
+
+#ifdef _WIN32
+
+int32_t gta_to_ue::serve::run_socket(const std::string& socket_path, const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers)
+{
+    std::cout << "socket: " << socket_path << " unix domain sockets are not supported on this platform, use --serve with stdin" << std::endl;
+    return 1;
+}
+
+#else
+
+// closed when the reader and the last pending response are done with it
+class Connection
+{
+public:
+    explicit Connection(int in_fd) : fd(in_fd) {}
+    ~Connection() { close(fd); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator = (const Connection&) = delete;
+
+    void send_line(const std::string& line)
+    {
+        std::lock_guard lock(mutex);
+        std::string data = line + "\n";
+        size_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (result <= 0) {
+                return;
+            }
+            sent += result;
+        }
+    }
+
+    int get_fd() const { return fd; }
+
+private:
+    int fd;
+    std::mutex mutex;
+};
+
+void serve_connection(std::shared_ptr<Connection> connection, gta_to_ue::WorkerPool& pool, const ConvertingOptions& converting_options, const ExportOptions& export_options)
+{
+    std::string pending;
+    char buffer[4096];
+    while (true) {
+        const ssize_t received = recv(connection->get_fd(), buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            return;
+        }
+        pending.append(buffer, received);
+
+        size_t line_begin = 0;
+        for (size_t line_end = pending.find('\n'); line_end != std::string::npos; line_end = pending.find('\n', line_begin)) {
+            const std::string line = pending.substr(line_begin, line_end - line_begin);
+            line_begin = line_end + 1;
+            if (is_blank(line)) {
+                continue;
+            }
+            submit_request(pool, line, converting_options, export_options, [connection](const std::string& response) {
+                connection->send_line(response);
+            });
+        }
+        pending.erase(0, line_begin);
+    }
+}
+
+int32_t gta_to_ue::serve::run_socket(const std::string& socket_path, const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers)
+{
+    sockaddr_un address{};
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cout << "socket: " << socket_path << " path is too long" << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd == -1) {
+        std::cout << "socket: " << socket_path << " can't be created: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // a socket file left by a previous run would make bind fail
+    unlink(socket_path.c_str());
+    if (bind(server_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 || listen(server_fd, SOMAXCONN) == -1) {
+        std::cout << "socket: " << socket_path << " can't be bound: " << std::strerror(errno) << std::endl;
+        close(server_fd);
+        return 1;
+    }
+
+    std::cout << "serving on " << socket_path << " with " << num_workers << " workers" << std::endl;
+
+    WorkerPool pool(num_workers);
+    std::vector<std::pair<std::weak_ptr<Connection>, std::thread>> readers;
+    while (true) {
+        const int client_fd = accept(server_fd, nullptr, nullptr);
+        if (client_fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            std::cout << "socket: " << socket_path << " accept error: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        // readers of closed connections with no pending responses are finished
+        std::erase_if(readers, [](auto& reader) {
+            if (!reader.first.expired()) {
+                return false;
+            }
+            reader.second.join();
+            return true;
+        });
+
+        auto connection = std::make_shared<Connection>(client_fd);
+        std::weak_ptr<Connection> weak_connection = connection;
+        readers.emplace_back(std::move(weak_connection), std::thread(serve_connection, std::move(connection), std::ref(pool), std::cref(converting_options), std::cref(export_options)));
+    }
+
+    // wakes up the readers still waiting for requests so they can be joined before the pool goes away
+    for (auto& [weak_connection, reader] : readers) {
+        if (const auto connection = weak_connection.lock()) {
+            shutdown(connection->get_fd(), SHUT_RD);
+        }
+        reader.join();
+    }
+    pool.wait();
+
+    close(server_fd);
+    unlink(socket_path.c_str());
+    return 1;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace serve {
+        /*
+         * conversion daemon, the rw engine must be initialized. every request is one json object per line:
+         *  {"id": "any string or integer", "input": "car.dff", "output": "car.dffbin", "car": true, "wheels": "wheels.dff",
+         *   "wheel_id": 237, "wheel_scale": 1.0, "morph_threshold": 0.01, "optimize": false, "lod_ratios": [0.5, 0.25], "format": "json|bin", "json_layout": "objects|compact",
+         *   "compress": "none|zstd[:level]", "quantize": false, "normal_bits": 16}
+         * only "input" is required, the other fields default to the options given on the command line.
+         * requests are converted concurrently and every one is answered with one line in completion order:
+         *  {"id": ..., "status": "ok", "input": ..., "output": ..., "queue_ms": 0.1, "convert_ms": 4.2}
+         * a request that can't be read is answered with status "bad request" and an "error" message
+         */
+
+        // serves stdin and answers on stdout until stdin is closed, log messages go to stderr
+        int32_t run_stdin(const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers);
+
+        // serves every connection of a unix domain socket, runs until the process is stopped
+        int32_t run_socket(const std::string& socket_path, const ConvertingOptions& converting_options, const ExportOptions& export_options, int32_t num_workers);
+    }
+}
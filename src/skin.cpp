@@ -0,0 +1,143 @@
+#include "skin.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+bool is_rigid(const gta_to_ue::Skeleton& skeleton, uint8_t& bone)
+{
+    if (skeleton.bone_indices.empty() || skeleton.weights.size() != skeleton.bone_indices.size()) {
+        return false;
+    }
+
+    bone = skeleton.bone_indices[0].bone1;
+    for (size_t i = 0; i < skeleton.weights.size(); i++) {
+        const gta_to_ue::VertexWeight& weight = skeleton.weights[i];
+        const gta_to_ue::BoneIndex& index = skeleton.bone_indices[i];
+        if (weight.weight1 != 1.f || weight.weight2 != 0.f || weight.weight3 != 0.f || weight.weight4 != 0.f
+            || index.bone1 != bone || index.bone2 != 0 || index.bone3 != 0 || index.bone4 != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool same_bind_skeleton(const gta_to_ue::Skeleton& a, const gta_to_ue::Skeleton& b)
+{
+    auto same_transform = [](const gta_to_ue::BoneTransform& x, const gta_to_ue::BoneTransform& y) {
+        return std::memcmp(&x, &y, sizeof(gta_to_ue::BoneTransform)) == 0;
+    };
+
+    return a.num_bones == b.num_bones && a.num_used_bones == b.num_used_bones && a.bone_ids == b.bone_ids
+        && std::equal(a.inverse_matrices.begin(), a.inverse_matrices.end(), b.inverse_matrices.begin(), b.inverse_matrices.end(), same_transform);
+}
+
+void gta_to_ue::skin::compact_skeletons(Mesh& mesh)
+{
+    const Geometry* first = nullptr;
+    bool same_skeleton = true;
+    for (auto& geometry : mesh.geometries) {
+        if (!geometry.has_skeleton) {
+            continue;
+        }
+
+        uint8_t bone;
+        if (geometry.skeleton.rigid_bone_id == -1 && is_rigid(geometry.skeleton, bone)) {
+            geometry.skeleton.rigid_bone_id = bone;
+            geometry.skeleton.bone_indices = {};
+            geometry.skeleton.weights = {};
+        }
+
+        if (!first) {
+            first = &geometry;
+        } else if (!same_bind_skeleton(first->skeleton, geometry.skeleton)) {
+            same_skeleton = false;
+        }
+    }
+
+    if (!first || !same_skeleton || mesh.same_skeleton) {
+        return;
+    }
+
+    mesh.same_skeleton = true;
+    mesh.skeleton.num_bones = first->skeleton.num_bones;
+    mesh.skeleton.num_used_bones = first->skeleton.num_used_bones;
+    mesh.skeleton.bone_ids = first->skeleton.bone_ids;
+    mesh.skeleton.inverse_matrices = first->skeleton.inverse_matrices;
+    for (auto& geometry : mesh.geometries) {
+        geometry.skeleton.bone_ids = {};
+        geometry.skeleton.inverse_matrices = {};
+    }
+}
+
+const gta_to_ue::Skeleton& gta_to_ue::skin::get_bind_skeleton(const Mesh& mesh, const Geometry& geometry)
+{
+    return mesh.same_skeleton && geometry.has_skeleton ? mesh.skeleton : geometry.skeleton;
+}
+
+gta_to_ue::BoneIndex gta_to_ue::skin::get_bone_index(const Geometry& geometry, size_t vertex)
+{
+    if (geometry.skeleton.rigid_bone_id != -1) {
+        return BoneIndex{ static_cast<uint8_t>(geometry.skeleton.rigid_bone_id), 0, 0, 0 };
+    }
+    return geometry.skeleton.bone_indices[vertex];
+}
+
+gta_to_ue::VertexWeight gta_to_ue::skin::get_weight(const Geometry& geometry, size_t vertex)
+{
+    if (geometry.skeleton.rigid_bone_id != -1) {
+        return VertexWeight{ 1.f, 0.f, 0.f, 0.f };
+    }
+    return geometry.skeleton.weights[vertex];
+}
+
+gta_to_ue::skin::CompactSkin gta_to_ue::skin::compact(const Geometry& geometry)
+{
+    CompactSkin compact_skin;
+    const auto& skeleton = geometry.skeleton;
+    const size_t num_vertices = std::min(skeleton.weights.size(), skeleton.bone_indices.size());
+
+    for (size_t i = 0; i < num_vertices; i++) {
+        const VertexWeight& weight = skeleton.weights[i];
+        const int32_t num_influences = (weight.weight1 > 0.f) + (weight.weight2 > 0.f) + (weight.weight3 > 0.f) + (weight.weight4 > 0.f);
+        compact_skin.num_influences = std::max(compact_skin.num_influences, num_influences);
+    }
+
+    const size_t stride = compact_skin.num_influences;
+    compact_skin.bone_indices.assign(num_vertices * stride, 0);
+    compact_skin.weights.assign(num_vertices * stride, 0);
+    for (size_t i = 0; i < num_vertices; i++) {
+        const float weights[4] = { skeleton.weights[i].weight1, skeleton.weights[i].weight2, skeleton.weights[i].weight3, skeleton.weights[i].weight4 };
+        const uint8_t bones[4] = { skeleton.bone_indices[i].bone1, skeleton.bone_indices[i].bone2, skeleton.bone_indices[i].bone3, skeleton.bone_indices[i].bone4 };
+
+        float sum = 0.f;
+        for (const float weight : weights) {
+            sum += std::max(weight, 0.f);
+        }
+        if (sum <= 0.f) {
+            continue;
+        }
+
+        // normalized to 255, the rounding error goes to the heaviest influence
+        size_t slot = 0;
+        size_t heaviest_slot = 0;
+        int32_t total = 0;
+        uint8_t* out_bones = &compact_skin.bone_indices[i * stride];
+        uint8_t* out_weights = &compact_skin.weights[i * stride];
+        for (size_t j = 0; j < 4; j++) {
+            if (weights[j] <= 0.f) {
+                continue;
+            }
+            out_bones[slot] = bones[j];
+            out_weights[slot] = static_cast<uint8_t>(std::round(weights[j] / sum * 255.f));
+            total += out_weights[slot];
+            if (out_weights[slot] > out_weights[heaviest_slot]) {
+                heaviest_slot = slot;
+            }
+            slot++;
+        }
+        out_weights[heaviest_slot] = static_cast<uint8_t>(out_weights[heaviest_slot] + 255 - total);
+    }
+
+    return compact_skin;
+}
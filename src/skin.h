@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace skin {
+        // 8-bit skin stream with num_influences slots per vertex, the weights of a vertex add up to 255
+        struct CompactSkin
+        {
+            int32_t num_influences{ 0 };
+            std::vector<uint8_t> bone_indices;
+            std::vector<uint8_t> weights;
+        };
+
+        // turns geometries bound to a single bone into rigid bindings and moves a skeleton that every skinned
+        // geometry has in common to the mesh (same_skeleton)
+        void compact_skeletons(Mesh& mesh);
+
+        // the skeleton holding the bone ids and inverse matrices of the geometry, the mesh one when it's shared and the geometry is skinned
+        const Skeleton& get_bind_skeleton(const Mesh& mesh, const Geometry& geometry);
+
+        // per-vertex influences, the rigid bone of a rigid binding is expanded to {bone, 0, 0, 0} with weights {1, 0, 0, 0}
+        BoneIndex get_bone_index(const Geometry& geometry, size_t vertex);
+        VertexWeight get_weight(const Geometry& geometry, size_t vertex);
+
+        // drops the slots without weight from the skin of a geometry that isn't rigid
+        CompactSkin compact(const Geometry& geometry);
+    }
+}
@@ -0,0 +1,629 @@
+#include "txd.h"
+#include "kernels.h"
+#include "mapped_file.h"
+#include "output_stream.h"
+#include "png.h"
+#include "profile.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+constexpr uint32_t platform_d3d8 = 8;
+constexpr uint32_t platform_d3d9 = 9;
+
+// rw raster format bits
+constexpr uint32_t raster_pixel_format_mask = 0x0F00;
+constexpr uint32_t raster_1555 = 0x0100;
+constexpr uint32_t raster_565 = 0x0200;
+constexpr uint32_t raster_4444 = 0x0300;
+constexpr uint32_t raster_lum8 = 0x0400;
+constexpr uint32_t raster_8888 = 0x0500;
+constexpr uint32_t raster_888 = 0x0600;
+constexpr uint32_t raster_555 = 0x0A00;
+constexpr uint32_t raster_pal8 = 0x2000;
+constexpr uint32_t raster_pal4 = 0x4000;
+
+constexpr uint32_t fourcc_dxt1 = 0x31545844;
+constexpr uint32_t fourcc_dxt3 = 0x33545844;
+
+using TextureReference = gta_to_ue::txd::TextureReference;
+
+std::atomic<bool> references_enabled{ false };
+std::mutex references_mutex;
+// keyed by the lowercase diffuse texture name
+std::map<std::string, TextureReference> references;
+
+std::string to_lower(std::string name)
+{
+    std::ranges::transform(name, name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return name;
+}
+
+// bounds checked reads of the texture native struct
+class StructReader
+{
+public:
+    StructReader(const uint8_t* in_data, size_t in_size) : data(in_data), size(in_size)
+    {}
+
+    bool read(void* out, size_t num_bytes)
+    {
+        if (num_bytes > size - offset) {
+            return false;
+        }
+        std::memcpy(out, data + offset, num_bytes);
+        offset += num_bytes;
+        return true;
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        return read(&value, sizeof(T));
+    }
+
+    bool read_name(std::string& name)
+    {
+        char buffer[33] = {};
+        if (!read(buffer, 32)) {
+            return false;
+        }
+        name = buffer;
+        return true;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset{ 0 };
+};
+
+size_t get_level_size(gta_to_ue::txd::PixelFormat format, int32_t width, int32_t height)
+{
+    using gta_to_ue::txd::PixelFormat;
+
+    const size_t num_blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    const size_t num_pixels = static_cast<size_t>(width) * height;
+    switch (format) {
+    case PixelFormat::dxt1:
+        return num_blocks * 8;
+    case PixelFormat::dxt3:
+        return num_blocks * 16;
+    case PixelFormat::pal4:
+    case PixelFormat::pal8:
+    case PixelFormat::lum8:
+        return num_pixels;
+    case PixelFormat::argb8888:
+    case PixelFormat::xrgb8888:
+        return num_pixels * 4;
+    default:
+        return num_pixels * 2;
+    }
+}
+
+bool get_pixel_format(uint32_t platform, uint32_t raster_format, uint32_t d3d_format, uint8_t compression, gta_to_ue::txd::PixelFormat& format)
+{
+    using gta_to_ue::txd::PixelFormat;
+
+    // d3d8 names the dxt format in the compression byte, d3d9 has the fourcc as d3d format with the compressed flag
+    const bool compressed = platform == platform_d3d8 ? compression != 0 : (compression & 0x08) != 0;
+    if (compressed) {
+        const uint32_t dxt = platform == platform_d3d8 ? compression : (d3d_format == fourcc_dxt1 ? 1 : d3d_format == fourcc_dxt3 ? 3 : 0);
+        if (dxt != 1 && dxt != 3) {
+            return false;
+        }
+        format = dxt == 1 ? PixelFormat::dxt1 : PixelFormat::dxt3;
+        return true;
+    }
+
+    if (raster_format & raster_pal8) {
+        format = PixelFormat::pal8;
+        return true;
+    }
+    if (raster_format & raster_pal4) {
+        format = PixelFormat::pal4;
+        return true;
+    }
+
+    switch (raster_format & raster_pixel_format_mask) {
+    case raster_1555:
+        format = PixelFormat::argb1555;
+        return true;
+    case raster_565:
+        format = PixelFormat::rgb565;
+        return true;
+    case raster_4444:
+        format = PixelFormat::argb4444;
+        return true;
+    case raster_lum8:
+        format = PixelFormat::lum8;
+        return true;
+    case raster_8888:
+        format = PixelFormat::argb8888;
+        return true;
+    case raster_888:
+        format = PixelFormat::xrgb8888;
+        return true;
+    case raster_555:
+        format = PixelFormat::xrgb1555;
+        return true;
+    }
+    return false;
+}
+
+// the struct of a d3d8 or d3d9 texture native:
+// platform, filter and addressing, name[32], mask[32], raster format, has alpha (d3d8) or d3d format (d3d9),
+// width, height, depth, num levels, raster type, compression (d3d8) or flags (d3d9), palette, { size, data } per level
+bool read_texture_native(const uint8_t* data, size_t size, gta_to_ue::txd::Texture& texture, const std::string& txd_file_name)
+{
+    StructReader reader(data, size);
+
+    uint32_t platform;
+    uint32_t filter_addressing;
+    uint32_t raster_format;
+    uint32_t d3d_format;
+    uint16_t width;
+    uint16_t height;
+    uint8_t depth;
+    uint8_t num_levels;
+    uint8_t raster_type;
+    uint8_t compression;
+    if (!reader.read(platform) || !reader.read(filter_addressing) || !reader.read_name(texture.name) || !reader.read_name(texture.mask)
+        || !reader.read(raster_format) || !reader.read(d3d_format) || !reader.read(width) || !reader.read(height)
+        || !reader.read(depth) || !reader.read(num_levels) || !reader.read(raster_type) || !reader.read(compression)) {
+        std::cout << "file: " << txd_file_name << " has a truncated texture" << std::endl;
+        return false;
+    }
+
+    if (platform != platform_d3d8 && platform != platform_d3d9) {
+        std::cout << "file: " << txd_file_name << " texture " << texture.name << " has the unsupported platform " << platform << std::endl;
+        return false;
+    }
+
+    if (!get_pixel_format(platform, raster_format, d3d_format, compression, texture.format)) {
+        std::cout << "file: " << txd_file_name << " texture " << texture.name << " has the unsupported raster format " << std::hex << raster_format << std::dec << std::endl;
+        return false;
+    }
+    texture.width = width;
+    texture.height = height;
+
+    if (texture.format == gta_to_ue::txd::PixelFormat::pal8 || texture.format == gta_to_ue::txd::PixelFormat::pal4) {
+        // pal4 palettes are stored with 32 entries, the unused ones stay black so any index is safe to look up
+        const size_t num_entries = texture.format == gta_to_ue::txd::PixelFormat::pal8 ? 256 : 32;
+        texture.palette.assign(256 * 4, 0);
+        if (!reader.read(texture.palette.data(), num_entries * 4)) {
+            std::cout << "file: " << txd_file_name << " texture " << texture.name << " has a truncated palette" << std::endl;
+            return false;
+        }
+    }
+
+    texture.levels.resize(std::max<uint8_t>(num_levels, 1));
+    for (size_t i = 0; i < texture.levels.size(); i++) {
+        uint32_t level_size;
+        if (!reader.read(level_size) || level_size > size) {
+            // some tools write fewer levels than they declare
+            texture.levels.resize(i);
+            break;
+        }
+        texture.levels[i].resize(level_size);
+        if (!reader.read(texture.levels[i].data(), level_size)) {
+            texture.levels.resize(i);
+            break;
+        }
+    }
+
+    if (texture.levels.empty() || texture.levels[0].size() < get_level_size(texture.format, texture.width, texture.height) / (texture.format == gta_to_ue::txd::PixelFormat::pal4 ? 2 : 1)) {
+        std::cout << "file: " << txd_file_name << " texture " << texture.name << " has no valid raster" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool gta_to_ue::txd::Dictionary::read(const uint8_t* data, size_t size, const std::string& txd_file_name)
+{
+    profile::add(profile::Counter::bytes_read, size);
+
+    rw::StreamMemory stream;
+
+    // librw only reads from the stream, the data stays untouched
+    stream.open(const_cast<uint8_t*>(data), static_cast<uint32_t>(size));
+
+    uint32_t struct_length;
+    if (!rw::findChunk(&stream, rw::ID_TEXDICTIONARY, nullptr, nullptr) || !rw::findChunk(&stream, rw::ID_STRUCT, &struct_length, nullptr) || struct_length < 4) {
+        std::cout << "file: " << txd_file_name << " is not a texture dictionary" << std::endl;
+        stream.close();
+        return false;
+    }
+
+    // the device id following the count isn't needed, the platform of every texture is in its native struct
+    const uint16_t num_textures = stream.readU16();
+    stream.seek(struct_length - 2);
+
+    std::vector<uint8_t> native_struct;
+    for (uint16_t i = 0; i < num_textures; i++) {
+        rw::ChunkHeaderInfo header;
+        if (!rw::readChunkHeaderInfo(&stream, &header) || header.type != rw::ID_TEXTURENATIVE) {
+            std::cout << "file: " << txd_file_name << " has " << i << " of " << num_textures << " textures" << std::endl;
+            break;
+        }
+        const uint32_t end = stream.tell() + header.length;
+
+        if (rw::findChunk(&stream, rw::ID_STRUCT, &struct_length, nullptr)) {
+            native_struct.resize(struct_length);
+            if (stream.read8(native_struct.data(), struct_length) == struct_length) {
+                Texture texture;
+                if (read_texture_native(native_struct.data(), native_struct.size(), texture, txd_file_name)
+                    && name_to_id.emplace(to_lower(texture.name), textures.size()).second) {
+                    textures.push_back(std::move(texture));
+                }
+            }
+        }
+
+        // skips the extension of the texture
+        stream.seek(static_cast<int32_t>(end - stream.tell()));
+    }
+
+    stream.close();
+    return true;
+}
+
+bool gta_to_ue::txd::Dictionary::read(const std::string& txd_file_name)
+{
+    MappedFile mapped_file;
+    if (!mapped_file.open(txd_file_name) || mapped_file.size() == 0 || mapped_file.size() > UINT32_MAX) {
+        std::cout << "file: " << txd_file_name << " is not found" << std::endl;
+        return false;
+    }
+
+    return read(mapped_file.data(), mapped_file.size(), txd_file_name);
+}
+
+const gta_to_ue::txd::Texture* gta_to_ue::txd::Dictionary::find(const std::string& name) const
+{
+    const auto it = name_to_id.find(to_lower(name));
+    return it != name_to_id.end() ? &textures[it->second] : nullptr;
+}
+
+size_t gta_to_ue::txd::Dictionary::get_num_textures() const
+{
+    return textures.size();
+}
+
+void decode_dxt(const gta_to_ue::txd::Texture& texture, gta_to_ue::txd::Image& image)
+{
+    const bool has_alpha_blocks = texture.format == gta_to_ue::txd::PixelFormat::dxt3;
+    const size_t block_size = has_alpha_blocks ? 16 : 8;
+    const size_t stride = static_cast<size_t>(image.width) * 4;
+    const uint8_t* block = texture.levels[0].data();
+    for (int32_t y = 0; y < image.height; y += 4) {
+        for (int32_t x = 0; x < image.width; x += 4, block += block_size) {
+            // dxt3 blocks are the 64 alpha bits followed by the color block
+            const uint8_t* color_block = has_alpha_blocks ? block + 8 : block;
+            const uint8_t* alpha_block = has_alpha_blocks ? block : nullptr;
+            gta_to_ue::kernels::decode_dxt_block(color_block, alpha_block, &image.rgba[y * stride + x * 4], stride,
+                std::min(4, image.width - x), std::min(4, image.height - y));
+        }
+    }
+}
+
+bool gta_to_ue::txd::decode(const Texture& texture, Image& image)
+{
+    if (texture.levels.empty()) {
+        return false;
+    }
+
+    image.width = texture.width;
+    image.height = texture.height;
+    const size_t num_pixels = static_cast<size_t>(texture.width) * texture.height;
+    image.rgba.resize(num_pixels * 4);
+
+    const uint8_t* src = texture.levels[0].data();
+    uint8_t* dst = image.rgba.data();
+    switch (texture.format) {
+    case PixelFormat::dxt1:
+    case PixelFormat::dxt3:
+        decode_dxt(texture, image);
+        break;
+    case PixelFormat::pal8:
+        kernels::expand_palette(src, num_pixels, texture.palette.data(), dst);
+        break;
+    case PixelFormat::pal4:
+        if (texture.levels[0].size() >= num_pixels) {
+            // d3d keeps pal4 rasters as 8-bit indices
+            kernels::expand_palette(src, num_pixels, texture.palette.data(), dst);
+        } else {
+            std::vector<uint8_t> indices(num_pixels);
+            for (size_t i = 0; i < num_pixels; i++) {
+                indices[i] = (src[i / 2] >> ((i % 2) * 4)) & 0x0F;
+            }
+            kernels::expand_palette(indices.data(), num_pixels, texture.palette.data(), dst);
+        }
+        break;
+    case PixelFormat::argb8888:
+        kernels::convert_bgra<false>(src, num_pixels, dst);
+        break;
+    case PixelFormat::xrgb8888:
+        kernels::convert_bgra<true>(src, num_pixels, dst);
+        break;
+    case PixelFormat::rgb565:
+        kernels::convert_16bit<11, 5, 5, 6, 0, 5, 0, 0>(src, num_pixels, dst);
+        break;
+    case PixelFormat::argb1555:
+        kernels::convert_16bit<10, 5, 5, 5, 0, 5, 15, 1>(src, num_pixels, dst);
+        break;
+    case PixelFormat::xrgb1555:
+        kernels::convert_16bit<10, 5, 5, 5, 0, 5, 0, 0>(src, num_pixels, dst);
+        break;
+    case PixelFormat::argb4444:
+        kernels::convert_16bit<8, 4, 4, 4, 0, 4, 12, 4>(src, num_pixels, dst);
+        break;
+    case PixelFormat::lum8:
+        for (size_t i = 0; i < num_pixels; i++) {
+            dst[i * 4 + 0] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+            dst[i * 4 + 3] = 0xFF;
+        }
+        break;
+    }
+
+    return true;
+}
+
+void gta_to_ue::txd::merge_mask(Image& image, const Image& mask)
+{
+    if (mask.width <= 0 || mask.height <= 0) {
+        return;
+    }
+
+    for (int32_t y = 0; y < image.height; y++) {
+        const int32_t mask_y = static_cast<int32_t>(static_cast<int64_t>(y) * mask.height / image.height);
+        for (int32_t x = 0; x < image.width; x++) {
+            const int32_t mask_x = static_cast<int32_t>(static_cast<int64_t>(x) * mask.width / image.width);
+            const uint8_t* mask_pixel = &mask.rgba[(static_cast<size_t>(mask_y) * mask.width + mask_x) * 4];
+            image.rgba[(static_cast<size_t>(y) * image.width + x) * 4 + 3] = static_cast<uint8_t>((mask_pixel[0] * 77 + mask_pixel[1] * 150 + mask_pixel[2] * 29) >> 8);
+        }
+    }
+}
+
+bool write_file(const std::string& file_name, const void* data, size_t size)
+{
+    gta_to_ue::FileOutputStream ofs;
+    if (!ofs.open(file_name)) {
+        return false;
+    }
+    ofs.write(data, size);
+    return ofs.close();
+}
+
+bool gta_to_ue::txd::write_png(const std::string& file_name, const Image& image)
+{
+    const size_t num_pixels = static_cast<size_t>(image.width) * image.height;
+    bool opaque = true;
+    for (size_t i = 0; i < num_pixels && opaque; i++) {
+        opaque = image.rgba[i * 4 + 3] == 0xFF;
+    }
+
+    std::vector<uint8_t> encoded;
+    if (opaque) {
+        std::vector<uint8_t> rgb(num_pixels * 3);
+        for (size_t i = 0; i < num_pixels; i++) {
+            std::memcpy(&rgb[i * 3], &image.rgba[i * 4], 3);
+        }
+        png::encode(rgb.data(), image.width, image.height, 3, encoded);
+    } else {
+        png::encode(image.rgba.data(), image.width, image.height, 4, encoded);
+    }
+
+    return write_file(file_name, encoded.data(), encoded.size());
+}
+
+// DDS_HEADER after the "DDS " magic, see the directx docs
+void write_dds_header(gta_to_ue::OutputStream& stream, int32_t width, int32_t height, uint32_t num_levels, uint32_t fourcc, uint32_t pitch_or_linear_size)
+{
+    constexpr uint32_t caps = 0x1;
+    constexpr uint32_t height_flag = 0x2;
+    constexpr uint32_t width_flag = 0x4;
+    constexpr uint32_t pitch = 0x8;
+    constexpr uint32_t pixel_format = 0x1000;
+    constexpr uint32_t mipmap_count = 0x20000;
+    constexpr uint32_t linear_size = 0x80000;
+    constexpr uint32_t pixel_format_alpha = 0x1;
+    constexpr uint32_t pixel_format_fourcc = 0x4;
+    constexpr uint32_t pixel_format_rgb = 0x40;
+    constexpr uint32_t caps_complex = 0x8;
+    constexpr uint32_t caps_texture = 0x1000;
+    constexpr uint32_t caps_mipmap = 0x400000;
+
+    uint32_t header[31] = {};
+    header[0] = 124;
+    header[1] = caps | height_flag | width_flag | pixel_format | (fourcc ? linear_size : pitch) | (num_levels > 1 ? mipmap_count : 0);
+    header[2] = static_cast<uint32_t>(height);
+    header[3] = static_cast<uint32_t>(width);
+    header[4] = pitch_or_linear_size;
+    header[6] = num_levels;
+    // pixel format
+    header[18] = 32;
+    if (fourcc) {
+        header[19] = pixel_format_fourcc;
+        header[20] = fourcc;
+    } else {
+        // r, g, b, a bytes
+        header[19] = pixel_format_rgb | pixel_format_alpha;
+        header[21] = 32;
+        header[22] = 0x000000FF;
+        header[23] = 0x0000FF00;
+        header[24] = 0x00FF0000;
+        header[25] = 0xFF000000;
+    }
+    header[26] = caps_texture | (num_levels > 1 ? caps_complex | caps_mipmap : 0);
+
+    stream.write("DDS ", 4);
+    stream.write(header, sizeof(header));
+}
+
+bool gta_to_ue::txd::write_dds(const std::string& file_name, const Image& image)
+{
+    FileOutputStream ofs;
+    if (!ofs.open(file_name)) {
+        return false;
+    }
+    write_dds_header(ofs, image.width, image.height, 1, 0, static_cast<uint32_t>(image.width) * 4);
+    ofs.write(image.rgba.data(), image.rgba.size());
+    return ofs.close();
+}
+
+bool gta_to_ue::txd::write_dds(const std::string& file_name, const Texture& texture)
+{
+    if (texture.format != PixelFormat::dxt1 && texture.format != PixelFormat::dxt3) {
+        return false;
+    }
+
+    FileOutputStream ofs;
+    if (!ofs.open(file_name)) {
+        return false;
+    }
+    write_dds_header(ofs, texture.width, texture.height, static_cast<uint32_t>(texture.levels.size()),
+        texture.format == PixelFormat::dxt1 ? fourcc_dxt1 : fourcc_dxt3, static_cast<uint32_t>(texture.levels[0].size()));
+    for (auto& level : texture.levels) {
+        ofs.write(level.data(), level.size());
+    }
+    return ofs.close();
+}
+
+void gta_to_ue::txd::record_references()
+{
+    references_enabled = true;
+}
+
+// a diffuse texture seen again keeps its first mask, or takes the mask of the new reference when it had none
+void merge_reference(std::map<std::string, TextureReference>& target, const TextureReference& reference)
+{
+    auto [it, added] = target.try_emplace(to_lower(reference.diffuse_texture), reference);
+    if (!added && it->second.mask_texture.empty()) {
+        it->second.mask_texture = reference.mask_texture;
+    }
+}
+
+std::vector<TextureReference> gta_to_ue::txd::get_references(const Mesh& mesh)
+{
+    std::map<std::string, TextureReference> mesh_references;
+    for (auto& material : mesh.materials) {
+        // names coming from fixed-size rw buffers carry trailing zeros
+        const std::string diffuse_texture(material.diffuse_texture.c_str());
+        const std::string mask_texture(material.mask_texture.c_str());
+        if (diffuse_texture.empty()) {
+            continue;
+        }
+
+        merge_reference(mesh_references, TextureReference{ diffuse_texture, mask_texture });
+    }
+
+    std::vector<TextureReference> result;
+    result.reserve(mesh_references.size());
+    for (auto& [key, reference] : mesh_references) {
+        result.push_back(std::move(reference));
+    }
+    return result;
+}
+
+void gta_to_ue::txd::add_references(const std::vector<TextureReference>& mesh_references)
+{
+    if (!references_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard lock(references_mutex);
+    for (auto& reference : mesh_references) {
+        merge_reference(references, reference);
+    }
+}
+
+bool extract_texture(const gta_to_ue::txd::Dictionary& dictionary, const TextureReference& reference, const std::string& file_name, gta_to_ue::txd::TextureFormat format)
+{
+    using gta_to_ue::txd::PixelFormat;
+
+    const gta_to_ue::profile::ScopedTimer timer(gta_to_ue::profile::Stage::extract_texture, reference.diffuse_texture);
+
+    const gta_to_ue::txd::Texture* texture = dictionary.find(reference.diffuse_texture);
+    const gta_to_ue::txd::Texture* mask = reference.mask_texture.empty() ? nullptr : dictionary.find(reference.mask_texture);
+
+    // compressed textures without a mask go to dds as they are, mip levels included
+    if (format == gta_to_ue::txd::TextureFormat::dds && !mask && (texture->format == PixelFormat::dxt1 || texture->format == PixelFormat::dxt3)) {
+        return gta_to_ue::txd::write_dds(file_name, *texture);
+    }
+
+    gta_to_ue::txd::Image image;
+    if (!gta_to_ue::txd::decode(*texture, image)) {
+        return false;
+    }
+
+    if (mask) {
+        gta_to_ue::txd::Image mask_image;
+        if (gta_to_ue::txd::decode(*mask, mask_image)) {
+            gta_to_ue::txd::merge_mask(image, mask_image);
+        }
+    }
+
+    return format == gta_to_ue::txd::TextureFormat::dds ? gta_to_ue::txd::write_dds(file_name, image) : gta_to_ue::txd::write_png(file_name, image);
+}
+
+bool gta_to_ue::txd::extract(const std::vector<std::string>& txd_files, const std::string& output_dir, TextureFormat format, int32_t num_workers)
+{
+    Dictionary dictionary;
+    for (auto& txd_file : txd_files) {
+        if (!dictionary.read(txd_file)) {
+            return false;
+        }
+    }
+
+    std::vector<TextureReference> found_references;
+    std::vector<std::string> missing_textures;
+    {
+        std::lock_guard lock(references_mutex);
+        for (auto& [key, reference] : references) {
+            if (dictionary.find(reference.diffuse_texture)) {
+                found_references.push_back(reference);
+            } else {
+                missing_textures.push_back(reference.diffuse_texture);
+            }
+        }
+    }
+
+    std::error_code error;
+    const std::filesystem::path directory = output_dir.empty() ? std::filesystem::path(".") : std::filesystem::path(output_dir);
+    std::filesystem::create_directories(directory, error);
+    const char* extension = format == TextureFormat::dds ? ".dds" : ".png";
+
+    std::atomic<int32_t> num_failed{ 0 };
+    {
+        WorkerPool pool(std::min<int32_t>(std::max(num_workers, 1), static_cast<int32_t>(std::max<size_t>(found_references.size(), 1))));
+        for (auto& reference : found_references) {
+            pool.submit([&dictionary, &reference, &directory, extension, format, &num_failed] {
+                const std::string file_name = (directory / (reference.diffuse_texture + extension)).string();
+                if (!extract_texture(dictionary, reference, file_name, format)) {
+                    std::ostringstream s;
+                    s << "file: " << file_name << " writing error" << std::endl;
+                    std::cout << s.str();
+                    num_failed++;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    for (auto& name : missing_textures) {
+        std::cout << "texture: " << name << " is not in the txd files" << std::endl;
+    }
+    std::cout << "textures: " << found_references.size() - num_failed << " extracted, " << missing_textures.size() << " missing, "
+        << num_failed << " failed (" << dictionary.get_num_textures() << " in the txd files)" << std::endl;
+
+    return num_failed == 0;
+}
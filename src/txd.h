@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+
+namespace gta_to_ue {
+    namespace txd {
+        enum class TextureFormat
+        {
+            png,
+            dds
+        };
+
+        // the d3d raster formats of pc txd files
+        enum class PixelFormat
+        {
+            dxt1,
+            dxt3,
+            pal4,
+            pal8,
+            argb8888,
+            xrgb8888,
+            rgb565,
+            argb1555,
+            xrgb1555,
+            argb4444,
+            lum8
+        };
+
+        struct Texture
+        {
+            std::string name;
+            std::string mask;
+            PixelFormat format;
+            int32_t width;
+            int32_t height;
+            // 256 r, g, b, a entries of paletted rasters
+            std::vector<uint8_t> palette;
+            // the raster data of every mip level, the first is the full size one
+            std::vector<std::vector<uint8_t>> levels;
+        };
+
+        // r, g, b, a rows without padding
+        struct Image
+        {
+            int32_t width{ 0 };
+            int32_t height{ 0 };
+            std::vector<uint8_t> rgba;
+        };
+
+        // the native textures of one or more txd files (d3d8 of gta3/vc pc, d3d9 of sa pc), textures are looked up case-insensitively
+        // and the first dictionary holding a name wins
+        class Dictionary
+        {
+        public:
+            bool read(const std::string& txd_file_name);
+            bool read(const uint8_t* data, size_t size, const std::string& txd_file_name);
+
+            const Texture* find(const std::string& name) const;
+            size_t get_num_textures() const;
+
+        private:
+            std::vector<Texture> textures;
+            std::unordered_map<std::string, size_t> name_to_id;
+        };
+
+        // decodes the first mip level
+        bool decode(const Texture& texture, Image& image);
+
+        // replaces the alpha of the image with the luminance of the mask, scaled to the image size
+        void merge_mask(Image& image, const Image& mask);
+
+        // 8-bit rgba png, or rgb when every pixel is opaque
+        bool write_png(const std::string& file_name, const Image& image);
+        // uncompressed 32-bit dds
+        bool write_dds(const std::string& file_name, const Image& image);
+        // dxt1/dxt3 textures with all their mip levels, without decoding them
+        bool write_dds(const std::string& file_name, const Texture& texture);
+
+        struct TextureReference
+        {
+            std::string diffuse_texture;
+            std::string mask_texture;
+        };
+
+        // the textures of the materials of a mesh, every diffuse texture once
+        std::vector<TextureReference> get_references(const Mesh& mesh);
+
+        // the converted meshes record the textures of their materials once this is called, the txd files are read
+        // after the conversion so only referenced textures are extracted. batch runs add the references kept in
+        // the conversion cache for the files they skip
+        void record_references();
+        void add_references(const std::vector<TextureReference>& mesh_references);
+
+        // decodes the referenced textures on num_workers threads and writes them to output_dir, named after the diffuse texture.
+        // a mask texture found in the dictionaries is merged into the alpha of its diffuse texture, textures missing
+        // from the dictionaries are reported but don't fail the extraction
+        bool extract(const std::vector<std::string>& txd_files, const std::string& output_dir, TextureFormat format, int32_t num_workers);
+    }
+}
@@ -0,0 +1,78 @@
+#include "worker_pool.h"
+
+using namespace gta_to_ue;
+
+WorkerPool::WorkerPool(int32_t in_num_workers)
+{
+    const int32_t num_workers = in_num_workers > 0 ? in_num_workers : get_default_num_workers();
+    workers.reserve(num_workers);
+    for (int32_t i = 0; i < num_workers; i++) {
+        workers.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    job_available.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_available.notify_one();
+}
+
+void WorkerPool::wait()
+{
+    std::unique_lock lock(mutex);
+    jobs_done.wait(lock, [this] { return jobs.empty() && num_running_jobs == 0; });
+}
+
+int32_t WorkerPool::get_num_workers() const
+{
+    return static_cast<int32_t>(workers.size());
+}
+
+int32_t WorkerPool::get_default_num_workers()
+{
+    const uint32_t num_threads = std::thread::hardware_concurrency();
+    return num_threads > 0 ? static_cast<int32_t>(num_threads) : 1;
+}
+
+void WorkerPool::worker_loop()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(mutex);
+            job_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            num_running_jobs++;
+        }
+
+        job();
+
+        {
+            std::lock_guard lock(mutex);
+            num_running_jobs--;
+            if (jobs.empty() && num_running_jobs == 0) {
+                jobs_done.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gta_to_ue {
+
+    class WorkerPool
+    {
+    public:
+        explicit WorkerPool(int32_t in_num_workers);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator = (const WorkerPool&) = delete;
+
+        void submit(std::function<void()> job);
+        void wait();
+
+        int32_t get_num_workers() const;
+
+        static int32_t get_default_num_workers();
+
+    private:
+        void worker_loop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable job_available;
+        std::condition_variable jobs_done;
+        int32_t num_running_jobs{ 0 };
+        bool stopping{ false };
+    };
+}